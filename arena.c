@@ -0,0 +1,116 @@
+/*
+// Arena allocator for RC6/RC5 key schedules and working buffers.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - POSIX mmap/mlock. MAP_HUGETLB and MADV_HUGEPAGE are used when
+ *   the headers define them (Linux) and silently skipped otherwise.
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "arena.h"
+
+#define HUGE_SZ ((size_t)2 << 20)       /* 2 MiB huge page          */
+
+struct arena {
+    unsigned char *base;    /* Start of mapping (this header lives here) */
+    size_t map_sz;          /* Bytes mapped                               */
+    size_t used;            /* Bytes handed out, including this header    */
+    int flags, huge;
+};
+
+static size_t round_up(size_t x, size_t m) { return (x+m-1)/m*m; }
+
+/* Map sz bytes aligned to HUGE_SZ so THP can back it. Returns NULL. */
+static void *map_aligned(size_t sz) {
+    size_t lead;
+    unsigned char *p = (unsigned char *)mmap(NULL, sz+HUGE_SZ,
+                PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+    lead = (HUGE_SZ - (uintptr_t)p % HUGE_SZ) % HUGE_SZ;
+    if (lead) munmap(p, lead);
+    munmap(p+lead+sz, HUGE_SZ-lead);
+    return p+lead;
+}
+
+arena *arena_create(size_t bytes, int flags) {
+    arena *a;
+    unsigned char *p = NULL;
+    int huge = 0;
+    size_t sz = round_up(bytes + round_up(sizeof(arena), ARENA_ALIGN),
+                         (flags & ARENA_HUGE) ? HUGE_SZ : 4096);
+#ifdef MAP_HUGETLB
+    if (flags & ARENA_HUGE) {
+        p = (unsigned char *)mmap(NULL, sz, PROT_READ|PROT_WRITE,
+                   MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if (p == (unsigned char *)MAP_FAILED) p = NULL;
+        else huge = 1;
+    }
+#endif
+    if (p == NULL) {
+        p = (unsigned char *)((flags & ARENA_HUGE) ? map_aligned(sz) :
+                mmap(NULL, sz, PROT_READ|PROT_WRITE,
+                     MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+        if (p == NULL || p == (unsigned char *)MAP_FAILED)
+            return NULL;
+#ifdef MADV_HUGEPAGE
+        if (flags & ARENA_HUGE) madvise(p, sz, MADV_HUGEPAGE);
+#endif
+    }
+    if (flags & ARENA_LOCK) {
+        if (mlock(p, sz) != 0) { munmap(p, sz); return NULL; }
+#ifdef MADV_DONTDUMP
+        madvise(p, sz, MADV_DONTDUMP);  /* Keep keys out of cores too */
+#endif
+    }
+    a = (arena *)p;
+    a->base = p;
+    a->map_sz = sz;
+    a->used = round_up(sizeof(arena), ARENA_ALIGN);
+    a->flags = flags;
+    a->huge = huge;
+    return a;
+}
+
+void arena_destroy(arena *a) {
+    if (a) {
+        unsigned char *p = a->base;
+        size_t sz = a->map_sz, used = a->used, i;
+        /* Only the bytes handed out can hold keys; wiping the rest
+         * would fault in pages never touched. Wipe through volatile
+         * so the stores are not elided.                            */
+        volatile unsigned char *v = p;
+        for (i=0; i<used; i++) v[i] = 0;
+        if (a->flags & ARENA_LOCK) munlock(p, sz);
+        munmap(p, sz);
+    }
+}
+
+void *arena_alloc(arena *a, size_t bytes) {
+    size_t sz = round_up(bytes ? bytes : 1, ARENA_ALIGN);
+    void *p;
+    if (sz > a->map_sz - a->used)
+        return NULL;
+    p = a->base + a->used;
+    a->used += sz;
+    return p;
+}
+
+void *arena_rc6_rkey(arena *a, int w, int r) {
+    return arena_alloc(a, (size_t)(w/8)*(2*r+4));
+}
+
+void *arena_rc5_rkey(arena *a, int w, int r) {
+    return arena_alloc(a, (size_t)(w/8)*(2*r+2));
+}
+
+size_t arena_avail(const arena *a) { return a->map_sz - a->used; }
+
+int arena_is_huge(const arena *a) { return a->huge; }
@@ -0,0 +1,46 @@
+/*
+// Arena allocator for RC6/RC5 key schedules and working buffers.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* An arena is one contiguous mapping from which key schedules and
+ * scratch buffers are carved. Allocations are never freed singly;
+ * the whole arena is wiped and released by arena_destroy. Keeping
+ * many schedules in one mapping (backed by 2 MiB pages when the OS
+ * allows) keeps key lookups from spraying across 4 KiB pages.
+ *
+ * Allocation is not thread-safe. Give each thread its own arena or
+ * serialize calls to arena_alloc.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_HUGE  1   /* Try explicit huge pages, then THP advice  */
+#define ARENA_LOCK  2   /* mlock the mapping so it never hits swap   */
+
+#define ARENA_ALIGN 64  /* Every allocation starts on a cache line   */
+
+typedef struct arena arena;
+
+/* arena_create returns NULL if the mapping cannot be made, or if
+ * ARENA_LOCK was requested and the pages could not be locked.
+ */
+arena *arena_create(size_t bytes, int flags);
+void arena_destroy(arena *a);
+
+/* arena_alloc returns ARENA_ALIGN-aligned memory or NULL when full */
+void *arena_alloc(arena *a, size_t bytes);
+
+/* Space for one rc6_setup/rc5_setup rkey with the given w and r    */
+void *arena_rc6_rkey(arena *a, int w, int r);
+void *arena_rc5_rkey(arena *a, int w, int r);
+
+/* Bytes still available, and nonzero if huge pages back the arena */
+size_t arena_avail(const arena *a);
+int arena_is_huge(const arena *a);
+
+#endif
@@ -0,0 +1,691 @@
+/*
+// Throughput benchmark for RC6/RC5 against AES-NI and ChaCha20.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Build against the rc6.h implementation to measure, eg:
+ *
+ *   for w in 8 16 32 64 128; do
+ *     cc -O3 -march=native -DWORD_SZ=$w bench.c modes.c rc6.c \
+ *        transpose.c rc6_small.c rc6_wide.c rc6_vec.c rc6_vert.c \
+ *        jit.c -lpthread -o bench$w &&
+ *     ./bench$w
+ *   done
+ *
+ * Usage: bench [r [max_threads]]. r defaults to the test vector draft's
+ * choice for each w (12/16/20/24/28) and max_threads to 4.
+ *
+ * bench xpose instead times transpose.c alone: one load and one
+ * store of 32-lane batches per pass, for the block size of every RC6
+ * and RC5 word size, on one thread. bench smallf compares the ways
+ * rc6_small.c computes f for RC6-8 and RC6-16.
+ *
+ * bench energy [r [max_threads]] runs every kernel for about a second
+ * per thread count on 64 KiB buffers and reports joules per GB from
+ * the RAPL package counters in /sys/class/powercap (intel-rapl, also
+ * used by the AMD driver), which usually need root to read. Energy is
+ * for the whole package, idle draw included, so the idle watts are
+ * printed first. To compare rc6.c with rc6_ref.c, build one binary
+ * against each as above.
+ *
+ * Every kernel encrypts its own buffer per thread in place, so the
+ * buffer sizes and thread counts are the same for all of them. Cycles
+ * are TSC ticks on x86 (nanoseconds elsewhere) and cycles/byte are
+ * per thread. An RC6/RC5 row is flagged competitive if it is no slower
+ * than the portable ChaCha20 on the same buffer size and thread count.
+ * ECB kernels do whole blocks only, so buffers shorter than one block
+ * show - and do not count.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "rc6.h"
+#include "modes.h"
+#include "rc6_vec.h"
+#include "transpose.h"
+#include "rc6_small.h"
+#include "rc6_wide.h"
+#include "rc6_vert.h"
+#include "jit.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_X86 1
+#define UNIT "cpb"
+static uint64_t ticks(void) { return __rdtsc(); }
+#else
+#define UNIT "ns/B"
+static uint64_t ticks(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000u + (uint64_t)t.tv_nsec;
+}
+#endif
+
+/* A kernel encrypts buf[0..len-1] in place under ctx, which it owns */
+typedef struct {
+    const char *name;
+    void (*run)(void *ctx, unsigned char *buf, size_t len);
+    void *ctx;
+    size_t ctx_sz;      /* Each thread gets a private copy of ctx   */
+    size_t min_len;     /* Whole blocks only: shorter is not timed  */
+    int baseline;       /* Not an RC6/RC5 kernel                    */
+} kernel;
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * R C 6   A N D   R C 5   K E R N E L S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+typedef struct {
+    unsigned char rkey[(1024/8)*(2*255+4)];     /* First: aligned   */
+    unsigned char ctr[BLK_MAX];
+    blkcipher bc;
+} rc_ctx;
+
+/* ctx copies move rkey, so point bc at this copy's schedule        */
+static void rc_ctr(void *ctx, unsigned char *buf, size_t len) {
+    rc_ctx *c = (rc_ctx *)ctx;
+    c->bc.rkey = c->rkey;
+    ctr_crypt(&c->bc, c->ctr, buf, buf, len);
+}
+
+static void rc_ecb(void *ctx, unsigned char *buf, size_t len) {
+    rc_ctx *c = (rc_ctx *)ctx;
+    size_t n = (size_t)c->bc.bpb;
+    for ( ; len >= n; len -= n, buf += n)
+        c->bc.enc(c->rkey, c->bc.w, c->bc.r, buf, buf);
+}
+
+/* ECB through the blkcipher's multi-block encn                    */
+static void rc_ecbn(void *ctx, unsigned char *buf, size_t len) {
+    rc_ctx *c = (rc_ctx *)ctx;
+    c->bc.rkey = c->rkey;
+    ecb_encrypt(&c->bc, buf, buf, len);
+}
+
+/* jit.c's unrolled code for one key; copies share the code        */
+typedef struct {
+    jit_fn fn;
+    int bpb;
+} jit_ctx;
+
+static void jit_run(void *ctx, unsigned char *buf, size_t len) {
+    jit_ctx *c = (jit_ctx *)ctx;
+    c->fn(buf, buf, len/(size_t)c->bpb);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * P O R T A B L E   C H A C H A 2 0   ( R F C   8 4 3 9 )
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+typedef struct { uint32_t s[16]; } chacha_ctx;
+
+#define ROTL32(x,n) ((x)<<(n) | (x)>>(32-(n)))
+#define QR(a,b,c,d) (a+=b, d^=a, d=ROTL32(d,16), c+=d, b^=c, b=ROTL32(b,12),\
+                     a+=b, d^=a, d=ROTL32(d, 8), c+=d, b^=c, b=ROTL32(b, 7))
+
+static void chacha_block(const uint32_t in[16], unsigned char out[64]) {
+    uint32_t x[16];
+    int i;
+    memcpy(x, in, sizeof(x));
+    for (i=0; i<10; i++) {
+        QR(x[0],x[4],x[ 8],x[12]); QR(x[1],x[5],x[ 9],x[13]);
+        QR(x[2],x[6],x[10],x[14]); QR(x[3],x[7],x[11],x[15]);
+        QR(x[0],x[5],x[10],x[15]); QR(x[1],x[6],x[11],x[12]);
+        QR(x[2],x[7],x[ 8],x[13]); QR(x[3],x[4],x[ 9],x[14]);
+    }
+    for (i=0; i<16; i++) {
+        uint32_t v = x[i] + in[i];
+        out[4*i] = (unsigned char)v;         out[4*i+1] = (unsigned char)(v>>8);
+        out[4*i+2] = (unsigned char)(v>>16); out[4*i+3] = (unsigned char)(v>>24);
+    }
+}
+
+static void chacha_run(void *ctx, unsigned char *buf, size_t len) {
+    chacha_ctx *c = (chacha_ctx *)ctx;
+    unsigned char ks[64];
+    size_t i, n;
+    for ( ; len > 0; len -= n, buf += n) {
+        chacha_block(c->s, ks);
+        c->s[12]++;
+        n = (len < 64 ? len : 64);
+        for (i=0; i<n; i++) buf[i] ^= ks[i];
+    }
+}
+
+static void chacha_init(chacha_ctx *c) {
+    static const uint32_t sigma[4] =
+        { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+    int i;
+    memcpy(c->s, sigma, sizeof(sigma));
+    for (i=4; i<16; i++) c->s[i] = (uint32_t)i * 0x01010101u;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * A E S - 1 2 8   W I T H   A E S - N I
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifdef HAVE_X86
+typedef struct { __m128i rk[11]; __m128i ctr; } aes_ctx;
+
+#define AESNI __attribute__((target("aes,sse4.1")))
+
+#define EXPAND(i, rcon) do {                                        \
+        __m128i t = _mm_aeskeygenassist_si128(k, rcon);             \
+        k = _mm_xor_si128(k, _mm_slli_si128(k, 4));                 \
+        k = _mm_xor_si128(k, _mm_slli_si128(k, 4));                 \
+        k = _mm_xor_si128(k, _mm_slli_si128(k, 4));                 \
+        c->rk[i] = k = _mm_xor_si128(k, _mm_shuffle_epi32(t, 0xff));\
+    } while (0)
+
+AESNI static void aes_init(aes_ctx *c) {
+    __m128i k = _mm_setr_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    c->rk[0] = k;
+    EXPAND(1, 0x01); EXPAND(2, 0x02); EXPAND(3, 0x04); EXPAND(4, 0x08);
+    EXPAND(5, 0x10); EXPAND(6, 0x20); EXPAND(7, 0x40); EXPAND(8, 0x80);
+    EXPAND(9, 0x1b); EXPAND(10, 0x36);
+    c->ctr = _mm_setzero_si128();
+}
+
+/* Eight blocks in flight hide the aesenc latency                  */
+AESNI static void aes_run(void *ctx, unsigned char *buf, size_t len) {
+    aes_ctx *c = (aes_ctx *)ctx;
+    const __m128i one = _mm_set_epi64x(0, 1);
+    __m128i x[8];
+    unsigned char tail[16];
+    int i, j;
+    for ( ; len >= 128; len -= 128, buf += 128) {
+        for (j=0; j<8; j++) {
+            x[j] = _mm_xor_si128(c->ctr, c->rk[0]);
+            c->ctr = _mm_add_epi64(c->ctr, one);
+        }
+        for (i=1; i<10; i++)
+            for (j=0; j<8; j++) x[j] = _mm_aesenc_si128(x[j], c->rk[i]);
+        for (j=0; j<8; j++) {
+            __m128i *p = (__m128i *)buf + j;
+            x[j] = _mm_aesenclast_si128(x[j], c->rk[10]);
+            _mm_storeu_si128(p, _mm_xor_si128(x[j], _mm_loadu_si128(p)));
+        }
+    }
+    for ( ; len > 0; len -= j, buf += j) {
+        x[0] = _mm_xor_si128(c->ctr, c->rk[0]);
+        c->ctr = _mm_add_epi64(c->ctr, one);
+        for (i=1; i<10; i++) x[0] = _mm_aesenc_si128(x[0], c->rk[i]);
+        _mm_storeu_si128((__m128i *)tail,
+                         _mm_aesenclast_si128(x[0], c->rk[10]));
+        for (j=0; j<16 && (size_t)j<len; j++) buf[j] ^= tail[j];
+    }
+}
+
+AESNI static void aes_ecb(void *ctx, unsigned char *buf, size_t len) {
+    aes_ctx *c = (aes_ctx *)ctx;
+    __m128i x[8];
+    int i, j;
+    for ( ; len >= 128; len -= 128, buf += 128) {
+        for (j=0; j<8; j++)
+            x[j] = _mm_xor_si128(_mm_loadu_si128((__m128i *)buf + j),
+                                 c->rk[0]);
+        for (i=1; i<10; i++)
+            for (j=0; j<8; j++) x[j] = _mm_aesenc_si128(x[j], c->rk[i]);
+        for (j=0; j<8; j++)
+            _mm_storeu_si128((__m128i *)buf + j,
+                             _mm_aesenclast_si128(x[j], c->rk[10]));
+    }
+    for ( ; len >= 16; len -= 16, buf += 16) {
+        x[0] = _mm_xor_si128(_mm_loadu_si128((__m128i *)buf), c->rk[0]);
+        for (i=1; i<10; i++) x[0] = _mm_aesenc_si128(x[0], c->rk[i]);
+        _mm_storeu_si128((__m128i *)buf,
+                         _mm_aesenclast_si128(x[0], c->rk[10]));
+    }
+}
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * H A R N E S S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+typedef struct {
+    const kernel *k;
+    size_t size, reps;
+    pthread_barrier_t *bar;
+} job;
+
+static void *worker(void *arg) {
+    job *j = (job *)arg;
+    unsigned char *buf = (unsigned char *)malloc(j->size + 64);
+    void *ctx = malloc(j->k->ctx_sz);
+    size_t i;
+    memcpy(ctx, j->k->ctx, j->k->ctx_sz);
+    memset(buf, 0x5c, j->size);
+    j->k->run(ctx, buf, j->size);                   /* Warm up      */
+    pthread_barrier_wait(j->bar);
+    for (i=0; i<j->reps; i++)
+        j->k->run(ctx, buf, j->size);
+    pthread_barrier_wait(j->bar);
+    free(buf); free(ctx);
+    return NULL;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * R A P L   E N E R G Y   C O U N T E R S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#define RAPL_MAX 16
+#ifndef RAPL_DIR
+#define RAPL_DIR "/sys/class/powercap"
+#endif
+
+/* The package domains: intel-rapl:N, not their intel-rapl:N:M zones */
+typedef struct {
+    int n;
+    char path[RAPL_MAX][64];            /* .../energy_uj            */
+    double range[RAPL_MAX];             /* Joules before wrapping   */
+} rapl;
+
+static int read_num(const char *path, double *v) {
+    FILE *f = fopen(path, "r");
+    int ok = (f != NULL && fscanf(f, "%lf", v) == 1);
+    if (f) fclose(f);
+    return ok;
+}
+
+/* Returns the number of readable package domains                  */
+static int rapl_open(rapl *r) {
+    char p[64];
+    double v;
+    int i;
+    r->n = 0;
+    for (i=0; i<RAPL_MAX; i++) {
+        sprintf(p, RAPL_DIR "/intel-rapl:%d/max_energy_range_uj", i);
+        if (!read_num(p, &r->range[r->n])) continue;
+        sprintf(r->path[r->n], RAPL_DIR "/intel-rapl:%d/energy_uj", i);
+        if (!read_num(r->path[r->n], &v)) continue;
+        r->range[r->n] /= 1e6;
+        r->n++;
+    }
+    return r->n;
+}
+
+static void rapl_read(const rapl *r, double e[]) {
+    int i;
+    for (i=0; i<r->n; i++) {
+        if (!read_num(r->path[i], &e[i])) e[i] = 0;
+        e[i] /= 1e6;
+    }
+}
+
+/* Joules used between two readings, allowing one wrap per domain  */
+static double rapl_joules(const rapl *r, const double a[], const double b[]) {
+    double j = 0;
+    int i;
+    for (i=0; i<r->n; i++)
+        j += (b[i] >= a[i] ? b[i] - a[i] : b[i] + r->range[i] - a[i]);
+    return j;
+}
+
+static double seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + 1e-9*(double)t.tv_nsec;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * M E A S U R E M E N T
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Run reps passes of k over size bytes on each of nthreads threads.
+ * Returns ticks between the barriers; secs gets wall time and, with
+ * r, joules the energy used in between.                           */
+static uint64_t run(const kernel *k, size_t size, int nthreads, size_t reps,
+                    const rapl *r, double *secs, double *joules) {
+    pthread_t tid[64];
+    job j;
+    pthread_barrier_t bar;
+    double e0[RAPL_MAX], e1[RAPL_MAX], s0, s1;
+    uint64_t t0, t1;
+    int t;
+    j.k = k; j.size = size; j.bar = &bar; j.reps = reps;
+    pthread_barrier_init(&bar, NULL, (unsigned)nthreads + 1);
+    for (t=0; t<nthreads; t++) pthread_create(&tid[t], NULL, worker, &j);
+    pthread_barrier_wait(&bar);
+    if (r) rapl_read(r, e0);
+    s0 = seconds();
+    t0 = ticks();
+    pthread_barrier_wait(&bar);
+    t1 = ticks();
+    s1 = seconds();
+    if (r) rapl_read(r, e1);
+    for (t=0; t<nthreads; t++) pthread_join(tid[t], NULL);
+    pthread_barrier_destroy(&bar);
+    if (secs) *secs = s1 - s0;
+    if (r && joules) *joules = rapl_joules(r, e0, e1);
+    return t1 - t0;
+}
+
+/* Per-thread cycles per byte of k on size-byte buffers            */
+static double measure(const kernel *k, size_t size, int nthreads) {
+    size_t reps = ((size_t)32 << 20) / size + 1;
+    return (double)run(k, size, nthreads, reps, NULL, NULL, NULL) /
+           ((double)reps * size);
+}
+
+/* Default rounds for each w, as in the RC6/RC5 test vector draft  */
+static int default_r(int w) {
+    switch (w) {
+    case 8: return 12;  case 16: return 16; case 32: return 20;
+    case 64: return 24; default: return 28;
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * T R A N S P O S E
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#define XP_LANES 32
+
+typedef struct {
+    uint32_t rows[XP_ROWS*XP_LANES];
+    xpose x;
+} xp_ctx;
+
+/* Blocks to lanes and back, in place, a batch at a time           */
+static void xp_run(void *ctx, unsigned char *buf, size_t len) {
+    xp_ctx *c = (xp_ctx *)ctx;
+    uint32_t *rows[4];
+    size_t n = (size_t)c->x.bpb*XP_LANES;
+    int v;
+    for (v=0; v<c->x.words; v++) rows[v] = c->rows + v*c->x.nl*XP_LANES;
+    for ( ; len >= n; len -= n, buf += n) {
+        xpose_load(&c->x, buf, rows);
+        xpose_store(&c->x, buf, rows);
+    }
+}
+
+static int bench_xpose(void) {
+    static xp_ctx c;
+    kernel k;
+    int w, words;
+    k.name = "xpose"; k.run = xp_run; k.ctx = &c;
+    k.ctx_sz = sizeof(c); k.baseline = 1;
+    printf("%-6s %-22s %-22s\n", "w", "RC6 bytes  " UNIT, "RC5 bytes  " UNIT);
+    for (w=8; w<=1024; w+=8) {
+        printf("%-6d", w);
+        for (words=4; words>=2; words-=2) {
+            xpose_init(&c.x, w, words, XP_LANES);
+            printf(" %5d %9.3f %-5s", c.x.bpb, measure(&k, 16384, 1),
+                   c.x.shuf ? "ssse3" : "");
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * S M A L L - W   R O U N D   F U N C T I O N
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+typedef struct {
+    uint64_t rkey[2*255+4];
+    int kind, w, r;
+} sf_ctx;
+
+static void sf_run(void *ctx, unsigned char *buf, size_t len) {
+    sf_ctx *c = (sf_ctx *)ctx;
+    rc6s_encrypt_with(c->kind, c->rkey, c->w, c->r, buf, buf,
+                      len/(size_t)(c->w/2));
+}
+
+static int bench_smallf(int r_opt) {
+    static const char *names[] = { "auto", "arith", "table", "gather", "permb" };
+    static sf_ctx c;
+    unsigned char key[16] = {0};
+    kernel k;
+    int w, kind;
+    k.name = "smallf"; k.run = sf_run; k.ctx = &c;
+    k.ctx_sz = sizeof(c); k.baseline = 1;
+    printf("%-14s %9s %9s\n", "RC6 f (" UNIT ")", "1024", "65536");
+    for (w=8; w<=16; w+=8) {
+        c.w = w; c.r = (r_opt > 0 ? r_opt : default_r(w));
+        rc6w_setup(c.rkey, w, c.r, 16, key);
+        for (kind=RC6S_AUTO; kind<=RC6S_PERMB; kind++) {
+            if (!rc6s_available(kind, w)) continue;
+            c.kind = kind;
+            printf("RC6-%-2d %-7s %9.2f %9.2f\n", w, names[kind],
+                   measure(&k, 1024, 1), measure(&k, 65536, 1));
+        }
+    }
+    return 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * K E R N E L   L I S T
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#define MAX_KERNELS 56
+
+typedef struct {
+    kernel k[MAX_KERNELS];
+    char names[MAX_KERNELS][32];
+    void *own[MAX_KERNELS];             /* Contexts to free         */
+    jit_kernel *jit[2];                 /* Code to free             */
+    int n, nown, njit, cha;             /* cha: ChaCha20's index    */
+    chacha_ctx cc;
+#ifdef HAVE_X86
+    aes_ctx ac;
+#endif
+} kernel_list;
+
+static kernel *add(kernel_list *l, void (*run)(void *, unsigned char *,
+                   size_t), void *ctx, size_t ctx_sz, int baseline) {
+    kernel *k = &l->k[l->n];
+    k->name = l->names[l->n++];
+    k->run = run; k->ctx = ctx; k->ctx_sz = ctx_sz; k->baseline = baseline;
+    k->min_len = 0;
+    return k;
+}
+
+/* rc6_vec.c's RC6 over a buffer, with an sf_ctx (kind unused)     */
+static void vx_run(void *ctx, unsigned char *buf, size_t len) {
+    sf_ctx *c = (sf_ctx *)ctx;
+    rc6x_encrypt(c->rkey, c->w, c->r, buf, buf, len/(size_t)(c->w/2));
+}
+
+/* Every w the linked rc6.h implementation accepts, RC6 and RC5, the
+ * batched RC6-8/16 of rc6_small.c, the portable vector RC6-8..64 of
+ * rc6_vec.c, RC6-256..1024 one block at a time (rc6_wide.c) and in
+ * lanes (rc6_vert.c), jit.c's RC6-32/64 where it generates code,
+ * then the baselines                                              */
+static void kernels_init(kernel_list *l, int r_opt) {
+    unsigned char key[32];
+    int i, w;
+    l->n = l->nown = l->njit = 0;
+    for (i=0; i<32; i++) key[i] = (unsigned char)i;
+    for (w=8; w<=1024; w+=8) {
+        int r = (r_opt > 0 ? r_opt : default_r(w)), c;
+        for (c=0; c<2 && l->n < 28; c++) {
+            rc_ctx *x = (rc_ctx *)calloc(1, sizeof(rc_ctx));
+            int bad = (c==0 ? rc6_setup(x->rkey, w, r, 16, key)
+                            : rc5_setup(x->rkey, w, r, 16, key));
+            if (bad) { free(x); continue; }
+            if (c==0) blkcipher_rc6(&x->bc, x->rkey, w, r);
+            else      blkcipher_rc5(&x->bc, x->rkey, w, r);
+            l->own[l->nown++] = x;
+            sprintf(l->names[l->n], "%s-%d/%d ctr", c ? "RC5" : "RC6", w, r);
+            add(l, rc_ctr, x, sizeof(rc_ctx), 0);
+            sprintf(l->names[l->n], "%s-%d/%d ecb", c ? "RC5" : "RC6", w, r);
+            add(l, rc_ecb, x, sizeof(rc_ctx), 0)->min_len = x->bc.bpb;
+        }
+    }
+    for (w=8; w<=16; w+=8) {
+        sf_ctx *x = (sf_ctx *)calloc(1, sizeof(sf_ctx));
+        x->kind = RC6S_AUTO; x->w = w;
+        x->r = (r_opt > 0 ? r_opt : default_r(w));
+        rc6w_setup(x->rkey, w, x->r, 16, key);
+        l->own[l->nown++] = x;
+        sprintf(l->names[l->n], "RC6-%d/%d small", w, x->r);
+        add(l, sf_run, x, sizeof(sf_ctx), 0)->min_len = w/2;
+    }
+    for (w=8; w<=64; w*=2) {
+        sf_ctx *x = (sf_ctx *)calloc(1, sizeof(sf_ctx));
+        x->w = w;
+        x->r = (r_opt > 0 ? r_opt : default_r(w));
+        rc6w_setup(x->rkey, w, x->r, 16, key);
+        l->own[l->nown++] = x;
+        sprintf(l->names[l->n], "RC6-%d/%d vec", w, x->r);
+        add(l, vx_run, x, sizeof(sf_ctx), 0)->min_len = w/2;
+    }
+    for (w=256; w<=1024; w*=2) {
+        int r = (r_opt > 0 ? r_opt : default_r(w));
+        rc_ctx *x = (rc_ctx *)calloc(1, sizeof(rc_ctx));
+        rc6w_setup(x->rkey, w, r, 16, key);
+        blkcipher_rc6v(&x->bc, x->rkey, w, r);
+        l->own[l->nown++] = x;
+        sprintf(l->names[l->n], "RC6-%d/%d wide", w, r);
+        add(l, rc_ecb, x, sizeof(rc_ctx), 0)->min_len = w/2;
+        sprintf(l->names[l->n], "RC6-%d/%d vert ctr", w, r);
+        add(l, rc_ctr, x, sizeof(rc_ctx), 0);
+        sprintf(l->names[l->n], "RC6-%d/%d vert ecb", w, r);
+        add(l, rc_ecbn, x, sizeof(rc_ctx), 0)->min_len = w/2;
+    }
+    for (w=32; w<=64; w*=2) {
+        int r = (r_opt > 0 ? r_opt : default_r(w));
+        jit_kernel *j = jit_rc6(w, r, 16, key, 0, 2);
+        jit_ctx *x;
+        if (j == NULL) continue;
+        x = (jit_ctx *)calloc(1, sizeof(jit_ctx));
+        x->fn = jit_entry(j);
+        x->bpb = w/2;
+        l->jit[l->njit++] = j;
+        l->own[l->nown++] = x;
+        sprintf(l->names[l->n], "RC6-%d/%d jit", w, r);
+        add(l, jit_run, x, sizeof(jit_ctx), 0)->min_len = w/2;
+    }
+    chacha_init(&l->cc);
+    l->cha = l->n;
+    strcpy(l->names[l->n], "ChaCha20");
+    add(l, chacha_run, &l->cc, sizeof(l->cc), 1);
+#ifdef HAVE_X86
+    if (__builtin_cpu_supports("aes")) {
+        aes_init(&l->ac);
+        strcpy(l->names[l->n], "AES-128-NI ctr");
+        add(l, aes_run, &l->ac, sizeof(l->ac), 1);
+        strcpy(l->names[l->n], "AES-128-NI ecb");
+        add(l, aes_ecb, &l->ac, sizeof(l->ac), 1);
+    }
+#endif
+}
+
+static void kernels_free(kernel_list *l) {
+    int i;
+    for (i=0; i<l->nown; i++) free(l->own[i]);
+    for (i=0; i<l->njit; i++) jit_free(l->jit[i]);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * E N E R G Y
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#define EN_SIZE 65536   /* Buffer per thread                         */
+#define EN_SECS 1.0     /* Target run time per kernel and thread count */
+
+/* Whole-package joules and seconds for about EN_SECS of k          */
+static void energy(const kernel *k, int nthreads, const rapl *r,
+                   double *gb, double *secs, double *joules) {
+    size_t reps = 16;
+    /* Grow a short run until it is long enough to scale from      */
+    for (;;) {
+        run(k, EN_SIZE, nthreads, reps, NULL, secs, NULL);
+        if (*secs >= EN_SECS/20 || reps > ((size_t)1 << 40)) break;
+        reps *= 4;
+    }
+    reps = (size_t)((double)reps * EN_SECS / (*secs > 0 ? *secs : 1e-9)) + 1;
+    run(k, EN_SIZE, nthreads, reps, r, secs, joules);
+    *gb = (double)reps * EN_SIZE * nthreads / 1e9;
+}
+
+static int bench_energy(int r_opt, int max_t) {
+    static const int threads[] = { 1, 2, 4, 8 };
+    static kernel_list l;
+    double e0[RAPL_MAX], e1[RAPL_MAX], s0, idle;
+    rapl r;
+    int i, t;
+    if (rapl_open(&r) == 0) {
+        fprintf(stderr, "bench: no readable RAPL domains under "
+                RAPL_DIR " (not supported, or needs root)\n");
+        return 1;
+    }
+    rapl_read(&r, e0);
+    s0 = seconds();
+    nanosleep(&(struct timespec){ 0, 500000000 }, NULL);
+    rapl_read(&r, e1);
+    idle = rapl_joules(&r, e0, e1) / (seconds() - s0);
+    printf("%d RAPL package domain(s), idle %.2f W\n", r.n, idle);
+    kernels_init(&l, r_opt);
+    printf("%-20s %3s %9s %9s %9s\n", "kernel", "thr", "GB/s", "W", "J/GB");
+    for (t=0; t<(int)(sizeof(threads)/sizeof(*threads)); t++) {
+        if (threads[t] > max_t) break;
+        for (i=0; i<l.n; i++) {
+            double gb, secs, j;
+            energy(&l.k[i], threads[t], &r, &gb, &secs, &j);
+            printf("%-20s %3d %9.3f %9.2f %9.2f\n", l.k[i].name, threads[t],
+                   gb/secs, j/secs, j/gb);
+        }
+    }
+    kernels_free(&l);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    static const size_t sizes[] = { 64, 1024, 16384, 1 << 20 };
+    static const int threads[] = { 1, 2, 4, 8 };
+    static kernel_list l;
+    kernel *ks = l.k;
+    int i, s, t, cha;
+    int r_opt = (argc > 1 ? atoi(argv[1]) : 0);
+    int max_t = (argc > 2 ? atoi(argv[2]) : 4);
+    if (argc > 1 && strcmp(argv[1], "xpose") == 0) return bench_xpose();
+    if (argc > 1 && strcmp(argv[1], "smallf") == 0)
+        return bench_smallf(argc > 2 ? atoi(argv[2]) : 0);
+    if (argc > 1 && strcmp(argv[1], "energy") == 0)
+        return bench_energy(argc > 2 ? atoi(argv[2]) : 0,
+                            argc > 3 ? atoi(argv[3]) : 4);
+    kernels_init(&l, r_opt);
+    cha = l.cha;
+    printf("%-20s %3s", "kernel (" UNIT ")", "thr");
+    for (s=0; s<(int)(sizeof(sizes)/sizeof(*sizes)); s++)
+        printf(" %9zu", sizes[s]);
+    printf("  competitive\n");
+    for (t=0; t<(int)(sizeof(threads)/sizeof(*threads)); t++) {
+        double base[4];
+        if (threads[t] > max_t) break;
+        for (s=0; s<4; s++) base[s] = measure(&ks[cha], sizes[s], threads[t]);
+        for (i=0; i<l.n; i++) {
+            int wins = 0, timed = 0;
+            printf("%-20s %3d", ks[i].name, threads[t]);
+            for (s=0; s<4; s++) {
+                double cpb;
+                if (sizes[s] < ks[i].min_len) {
+                    printf(" %9s", "-");
+                    continue;
+                }
+                cpb = (i==cha ? base[s] :
+                       measure(&ks[i], sizes[s], threads[t]));
+                wins += (cpb <= base[s]);
+                timed++;
+                printf(" %9.2f", cpb);
+            }
+            printf("  %s\n", ks[i].baseline ? "" :
+                             wins == timed ? "yes" :
+                             wins ? "some sizes" : "no");
+        }
+    }
+    kernels_free(&l);
+    return 0;
+}
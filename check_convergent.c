@@ -0,0 +1,154 @@
+/*
+// Check convergent.c: dedup, stable cuts and round trips.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Build and run with:
+ *
+ *   cc -O2 check_convergent.c convergent.c executor.c rc6_wide.c \
+ *      rc6_vert.c transpose.c modes.c rc6_ref.c -lpthread \
+ *      -o check_convergent && ./check_convergent
+ *
+ * For w = 1024 and 128 (CTR through the rc6_vert.c kernels for long
+ * chunks) and 64 and 32 (rc6w only), with random round counts,
+ * secrets and average chunk sizes, random data is encrypted twice
+ * over, then again behind a random-length insertion. Chunks of equal
+ * content must get equal keys and ciphertext, and the copy must
+ * repeat some; the cuts in the second half of the data must not move
+ * with the insertion; every chunk must decrypt to its plaintext; the
+ * output must not depend on the number of tasks; and some chunks
+ * must match a reference built on rc6_ref.c (the CBC-MAC of
+ * convergent.h, then CTR from a zero big-endian counter). Prints the
+ * failures and exits nonzero if there are any.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rc6.h"
+#include "convergent.h"
+
+#define HALF   (96 << 10)   /* Bytes of random data, written twice   */
+#define INS    3000         /* Bytes inserted, at most               */
+#define MAXC   4000         /* Chunks per input, at most             */
+#define TRIES  4            /* Keys per w                            */
+#define REFS   3            /* Chunks checked against the reference  */
+
+static unsigned char in[2*HALF + INS], out[2*HALF + INS];
+static unsigned char out2[2*HALF + INS];
+static unsigned char dec[64 << 10], ref[64 << 10]; /* 4*avg_sz at most */
+static conv_chunk ch[MAXC], ch2[MAXC];
+static unsigned char rkr[8*16*(2*255+4)];
+
+static int bad;
+
+static void fail(const char *what, int w, int r, size_t avg) {
+    if (bad++ < 20)
+        printf("FAIL %s RC6-%d/%d, avg_sz %zu\n", what, w, r, avg);
+}
+
+/* Chunk p[0..len-1] encrypted as convergent.h describes, to o      */
+static void reference(int w, int r, const unsigned char *secret, int sl,
+                      const unsigned char *p, size_t len, unsigned char *o) {
+    unsigned char x[512], ctr[512], key[CONV_KEY_MAX];
+    size_t i, j, n = (size_t)w/2;
+    int kl = (w/2 < CONV_KEY_MAX ? w/2 : CONV_KEY_MAX), k;
+    rc6_setup(rkr, w, r, sl, (void *)secret);
+    memset(x, 0, n);
+    for (i=0; i<8; i++) x[n-1-i] = (unsigned char)(len >> 8*i);
+    rc6_encrypt(rkr, w, r, x, x);
+    for (i=0; i<len; i+=n) {
+        for (j=0; j<n && i+j<len; j++) x[j] ^= p[i+j];
+        rc6_encrypt(rkr, w, r, x, x);
+    }
+    memcpy(key, x, kl);
+    rc6_setup(rkr, w, r, kl, key);
+    memset(ctr, 0, n);
+    for (i=0; i<len; i+=n) {
+        rc6_encrypt(rkr, w, r, ctr, x);
+        for (j=0; j<n && i+j<len; j++) o[i+j] = p[i+j] ^ x[j];
+        for (k=(int)n-1; k>=0 && ++ctr[k]==0; k--) ;
+    }
+}
+
+static void check(int w, int t) {
+    static const size_t avgs[] = { 256, 1024, 4096, 16384 };
+    unsigned char secret[32];
+    size_t avg = avgs[t % 4], len = 2*HALF, ins = 1 + rand() % INS;
+    size_t n, n2, i, j, dups = 0;
+    int r = rand() % 21, sl = rand() % 33;
+    conv_ctx c;
+    for (i=0; i<(size_t)sl; i++) secret[i] = (unsigned char)rand();
+    if (conv_init(&c, w, r, secret, sl, avg, 1 + t % 3)) {
+        fail("init", w, r, avg);
+        return;
+    }
+    for (i=0; i<HALF; i++) in[i] = (unsigned char)rand();
+    memcpy(in + HALF, in, HALF);
+    n = conv_encrypt(&c, in, out, len, ch, MAXC);
+    if (n == 0 || ch[n-1].off + ch[n-1].len != len) {
+        fail("chunk count", w, r, avg);
+        conv_free(&c);
+        return;
+    }
+    /* Equal chunks, equal keys and ciphertext; and a round trip    */
+    for (i=0; i<n; i++) {
+        for (j=i+1; j<n; j++)
+            if (ch[i].len == ch[j].len &&
+                !memcmp(in + ch[i].off, in + ch[j].off, ch[i].len)) {
+                dups++;
+                if (memcmp(ch[i].key, ch[j].key, (size_t)c.keylen) ||
+                    memcmp(out + ch[i].off, out + ch[j].off, ch[i].len))
+                    fail("equal chunks", w, r, avg);
+            }
+        if (conv_decrypt_chunk(&c, ch + i, out + ch[i].off, dec) ||
+            memcmp(dec, in + ch[i].off, ch[i].len))
+            fail("round trip", w, r, avg);
+        if (ch[i].len >= 16 &&
+            memcmp(out + ch[i].off, in + ch[i].off, ch[i].len) == 0)
+            fail("ciphertext is plaintext", w, r, avg);
+    }
+    if (dups == 0) fail("no repeated chunks", w, r, avg);
+    /* Some chunks, short and long, against the reference           */
+    for (i=0; i<REFS && i<n; i++) {
+        conv_chunk *x = ch + (i == 0 ? 0 : i == 1 ? n-1 : n/2);
+        reference(w, r, secret, sl, in + x->off, x->len, ref);
+        if (memcmp(ref, out + x->off, x->len))
+            fail("reference", w, r, avg);
+    }
+    /* One task, and behind an insertion: same cuts in the tail     */
+    c.nthreads = 1 + (c.nthreads % 4);
+    memmove(in + ins, in, len);
+    for (i=0; i<ins; i++) in[i] = (unsigned char)rand();
+    n2 = conv_encrypt(&c, in, out2, len + ins, ch2, MAXC);
+    for (i=0, j=0; i<n; i++) {
+        if (ch[i].off < HALF) continue;
+        while (j < n2 && ch2[j].off < ch[i].off + ins) j++;
+        if (j == n2 || ch2[j].off != ch[i].off + ins ||
+            ch2[j].len != ch[i].len ||
+            memcmp(out + ch[i].off, out2 + ch2[j].off, ch[i].len)) {
+            fail("cuts after an insertion", w, r, avg);
+            break;
+        }
+    }
+    conv_free(&c);
+}
+
+int main(void) {
+    conv_ctx c;
+    int t, runs = 0;
+    srand(1);
+    for (t=0; t<TRIES; t++, runs++) check(1024, t);
+    for (t=0; t<TRIES; t++, runs++) check(128, t);
+    for (t=0; t<TRIES; t++, runs++) check(64, t);
+    for (t=0; t<TRIES; t++, runs++) check(32, t);
+    if (conv_init(&c, 16, 12, "k", 1, 4096, 1) == 0) {
+        printf("FAIL conv_init with w=16 is 0\n");
+        bad++;
+        conv_free(&c);
+    }
+    printf("convergent: %d keys, %d failures\n", runs, bad);
+    return bad != 0;
+}
@@ -0,0 +1,155 @@
+/*
+// Check executor.c: exec_for, nesting, custom executors, pool teardown.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Build and run with:
+ *
+ *   cc -O2 check_exec.c executor.c -lpthread -o check_exec &&
+ *   ./check_exec
+ *
+ * and with -fsanitize=thread for the races. On pools of 1 to 4
+ * threads and on exec_default(), exec_for must run every i exactly
+ * once, also when each i runs an exec_for of its own on the same
+ * executor, with costs above and below EXEC_SMALL. With an executor
+ * that runs tasks inline in submit, and with one that holds them
+ * until after exec_for has returned, exec_for must still finish with
+ * every i run once. Destroying a pool must run the tasks still queued
+ * on it. Prints the failures and exits nonzero if there are any.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "executor.h"
+
+#define MAXN  2000          /* Iterations per exec_for, at most      */
+#define INNER 16            /* Iterations of each nested exec_for    */
+#define QUEUE 1000          /* Tasks queued before a pool is freed   */
+
+static executor *ex;
+static int runs[MAXN], inner[MAXN][INNER];
+static size_t inner_cost;
+static int ran;
+
+static int bad;
+
+static void fail(const char *what, const char *on, size_t n) {
+    if (bad++ < 20)
+        printf("FAIL %s on %s, n=%zu\n", what, on, n);
+}
+
+static void once(void *ctx, size_t i) {
+    (void)ctx;
+    __atomic_fetch_add(&runs[i], 1, __ATOMIC_RELAXED);
+}
+
+static void leaf(void *ctx, size_t i) {
+    __atomic_fetch_add(&((int *)ctx)[i], 1, __ATOMIC_RELAXED);
+}
+
+static void outer(void *ctx, size_t i) {
+    (void)ctx;
+    exec_for(ex, INNER, inner_cost, leaf, inner[i]);
+    __atomic_fetch_add(&runs[i], 1, __ATOMIC_RELAXED);
+}
+
+/* Keeps a pool thread busy so that what follows stays queued      */
+static void nap(void *arg) {
+    struct timespec ts = { 0, 20000000 };
+    (void)arg;
+    nanosleep(&ts, NULL);
+}
+
+static void count(void *arg) {
+    (void)arg;
+    __atomic_fetch_add(&ran, 1, __ATOMIC_RELAXED);
+}
+
+/* Flat and nested loops of a few sizes on ex                      */
+static void loops(const char *on) {
+    static const size_t ns[] = { 0, 1, 2, 7, 64, MAXN };
+    size_t k, i, j;
+    for (k=0; k<sizeof(ns)/sizeof(ns[0]); k++) {
+        size_t n = ns[k];
+        memset(runs, 0, sizeof(runs));
+        exec_for(ex, n, 0, once, NULL);
+        for (i=0; i<MAXN; i++)
+            if (runs[i] != (i < n)) {
+                fail("exec_for", on, n);
+                break;
+            }
+        if (n > 64) continue;
+        inner_cost = (k & 1 ? EXEC_SMALL/2 : EXEC_SMALL*4);
+        memset(runs, 0, sizeof(runs));
+        memset(inner, 0, sizeof(inner));
+        exec_for(ex, n, EXEC_SMALL*4, outer, NULL);
+        for (i=0; i<n; i++)
+            for (j=0; j<INNER; j++)
+                if (runs[i] != 1 || inner[i][j] != 1) {
+                    fail("nested exec_for", on, n);
+                    i = n;
+                    break;
+                }
+    }
+}
+
+/* Runs each task before submit returns                            */
+static void inline_submit(void *self, exec_task fn, void *arg,
+                          size_t cost) {
+    (void)self; (void)cost;
+    fn(arg);
+}
+
+/* Holds tasks until held_run, like a pool busy with other work    */
+static struct { exec_task fn; void *arg; } held[MAXN];
+static size_t nheld;
+
+static void held_submit(void *self, exec_task fn, void *arg,
+                        size_t cost) {
+    (void)self; (void)cost;
+    if (nheld == MAXN) {
+        fn(arg);
+        return;
+    }
+    held[nheld].fn = fn;
+    held[nheld++].arg = arg;
+}
+
+static void held_run(void) {
+    size_t i;
+    for (i=0; i<nheld; i++) held[i].fn(held[i].arg);
+    nheld = 0;
+}
+
+int main(void) {
+    executor in = { inline_submit, NULL }, hold = { held_submit, NULL };
+    int t, i;
+    char on[32];
+    for (t=1; t<=4; t++) {
+        sprintf(on, "a pool of %d", t);
+        if ((ex = exec_pool_create(t)) == NULL) {
+            fail("exec_pool_create", on, 0);
+            continue;
+        }
+        loops(on);
+        ran = 0;
+        for (i=0; i<t; i++) ex->submit(ex->self, nap, NULL, 0);
+        for (i=0; i<QUEUE; i++) ex->submit(ex->self, count, NULL, 0);
+        exec_pool_destroy(ex);
+        if (ran != QUEUE) fail("tasks run by destroy", on, QUEUE);
+    }
+    ex = NULL;
+    loops("exec_default()");
+    ex = &in;
+    loops("an inline executor");
+    ex = &hold;
+    loops("a holding executor");
+    held_run();
+    printf("executor: %d failures\n", bad);
+    return bad != 0;
+}
@@ -0,0 +1,126 @@
+/*
+// Check ipanon.c against a one-bit-at-a-time reference.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Build and run with:
+ *
+ *   cc -O2 -march=native check_ipanon.c ipanon.c rc6_vec.c \
+ *      rc6_wide.c rc6_ref.c modes.c -o check_ipanon && ./check_ipanon
+ *
+ * The reference computes bit i of an anonymized address as bit i of
+ * the address xor the top bit of rc6_ref.c's encryption of its first
+ * i bits followed by the rest of E(0), as ipanon.h describes. For
+ * RC6-16 (IPv4) and RC6-32 (IPv4 and IPv6), with random keys, round
+ * counts, cache sizes (none, part of the address, all of it) and
+ * trie limits (including a trie that fills up), every address of a
+ * batch must match the reference, in place and out of place, and a
+ * second pass through the warm trie must give the same output. The
+ * addresses are drawn from a few random prefixes so the trie is
+ * shared. Prints the failures and exits nonzero if there are any.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rc6.h"
+#include "ipanon.h"
+
+#define MAXN  500           /* Addresses per call, at most           */
+#define TRIES 60            /* Keys per w and address size           */
+
+static unsigned char in[MAXN*16], out[MAXN*16], ref[MAXN*16];
+static unsigned char rkr[4*(2*255+4)];
+
+static int bad;
+
+static void fail(const char *what, int w, int r, int nb, int cache,
+                 size_t max_nodes) {
+    if (bad++ < 20)
+        printf("FAIL %s RC6-%d/%d, IPv%d, cache %d bits, %zu nodes\n",
+               what, w, r, nb == 4 ? 4 : 6, cache, max_nodes);
+}
+
+static int bit(const unsigned char *a, int i) {
+    return a[i>>3] >> (7 - (i&7)) & 1;
+}
+
+/* Anonymize one address of nb bytes with the key in rkr           */
+static void reference(int w, int r, const unsigned char *pad,
+                      const unsigned char *addr, unsigned char *o,
+                      int nb) {
+    unsigned char b[16];
+    int i, j;
+    memcpy(o, addr, nb);
+    for (i=0; i<8*nb; i++) {
+        memcpy(b, pad, w/2);
+        for (j=0; j<i; j++) {
+            b[j>>3] &= ~(0x80 >> (j&7));
+            b[j>>3] |= bit(addr, j) << (7 - (j&7));
+        }
+        rc6_encrypt(rkr, w, r, b, b);
+        o[i>>3] ^= (b[0] >> 7) << (7 - (i&7));
+    }
+}
+
+static void check(int w, int nb, int i) {
+    static const int caches[] = { 0, 16, 128 };
+    static const size_t limits[] = { 1, 40, 1000000 };
+    unsigned char key[32], pad[16], base[4][16];
+    int r = rand() % 25, kb = rand() % 33;
+    int cache = caches[i % 3];
+    size_t max_nodes = limits[i/3 % 3];
+    size_t n = 1 + (size_t)rand() % MAXN, j;
+    ipanon *a;
+    for (j=0; j<(size_t)kb; j++) key[j] = (unsigned char)rand();
+    for (j=0; j<sizeof(base); j++)
+        base[j/16][j%16] = (unsigned char)rand();
+    /* Each address keeps a random-length prefix of a base         */
+    for (j=0; j<n; j++) {
+        unsigned char *p = in + j*nb;
+        int k, keep = rand() % (8*nb + 1);
+        memcpy(p, base[rand() % 4], nb);
+        for (k=keep; k<8*nb; k++)
+            if (rand() & 1) p[k>>3] ^= 0x80 >> (k&7);
+    }
+    a = ipanon_create(w, r, key, kb, cache, max_nodes);
+    if (a == NULL) {
+        fail("create", w, r, nb, cache, max_nodes);
+        return;
+    }
+    rc6_setup(rkr, w, r, kb, key);
+    memset(pad, 0, sizeof(pad));
+    rc6_encrypt(rkr, w, r, pad, pad);
+    for (j=0; j<n; j++)
+        reference(w, r, pad, in + j*nb, ref + j*nb, nb);
+    if ((nb == 4 ? ipanon_v4 : ipanon_v6)(a, in, out, n))
+        fail("return", w, r, nb, cache, max_nodes);
+    else if (memcmp(out, ref, n*nb))
+        fail("cold", w, r, nb, cache, max_nodes);
+    memcpy(out, in, n*nb);
+    (nb == 4 ? ipanon_v4 : ipanon_v6)(a, out, out, n);
+    if (memcmp(out, ref, n*nb))
+        fail("warm, in place", w, r, nb, cache, max_nodes);
+    if (ipanon_nodes(a) > max_nodes)
+        fail("node limit", w, r, nb, cache, max_nodes);
+    ipanon_destroy(a);
+}
+
+int main(void) {
+    ipanon *a;
+    int i, runs = 0;
+    srand(1);
+    for (i=0; i<TRIES; i++, runs++) check(16, 4, i);
+    for (i=0; i<TRIES; i++, runs++) check(32, 4, i);
+    for (i=0; i<TRIES; i++, runs++) check(32, 16, i);
+    a = ipanon_create(16, 12, "k", 1, 16, 100);
+    if (a == NULL || ipanon_v6(a, in, out, 1) != -1) {
+        printf("FAIL ipanon_v6 with RC6-16 is not -1\n");
+        bad++;
+    }
+    ipanon_destroy(a);
+    printf("ipanon: %d keys, %d failures\n", runs, bad);
+    return bad != 0;
+}
@@ -0,0 +1,91 @@
+/*
+// Check jit.c against rc6_ref.c.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Build and run with:
+ *
+ *   cc -O2 check_jit.c jit.c rc6_wide.c rc6_ref.c -o check_jit &&
+ *   ./check_jit
+ *
+ * For RC6 and RC5 at w = 32 and 64, with random keys, round counts
+ * (including 0 and 255), lane counts and block counts, the generated
+ * encryption and decryption must agree block for block with
+ * rc6_ref.c, in place and out of place. Where jit.c generates no code
+ * (not x86-64) the program says so and exits 0; otherwise it prints
+ * the failures and exits nonzero if there are any.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rc6.h"
+#include "jit.h"
+
+#define MAXN  100           /* Blocks per call, at most              */
+#define TRIES 100           /* Keys per w and cipher                 */
+
+static unsigned char pt[MAXN*32], ct[MAXN*32], dt[MAXN*32];
+static unsigned char rkr[8*(2*255+4)];
+
+static int bad;
+
+static void fail(const char *what, int rc5, int w, int r, int lanes,
+                 size_t n) {
+    if (bad++ < 20)
+        printf("FAIL %s RC%d-%d/%d, %d lanes, %zu blocks\n", what,
+               rc5 ? 5 : 6, w, r, lanes, n);
+}
+
+/* One random key; 0 if no code was generated for it               */
+static int check(int rc5, int w, int i) {
+    unsigned char key[32], e[32];
+    int r = (i == 0 ? 0 : i == 1 ? 255 : rand() % 41);
+    int kb = rand() % 33, lanes = 1 + rand() % (rc5 ? 4 : 2);
+    int bpb = (rc5 ? w/4 : w/2);
+    size_t n = (size_t)rand() % (MAXN+1), j;
+    jit_kernel *ke, *kd;
+    for (j=0; j<(size_t)kb; j++) key[j] = (unsigned char)rand();
+    for (j=0; j<n*bpb; j++) pt[j] = (unsigned char)rand();
+    ke = (rc5 ? jit_rc5 : jit_rc6)(w, r, kb, key, 0, lanes);
+    kd = (rc5 ? jit_rc5 : jit_rc6)(w, r, kb, key, 1, lanes);
+    if (ke == NULL || kd == NULL) {
+        jit_free(ke);
+        jit_free(kd);
+        return 0;
+    }
+    if (rc5) rc5_setup(rkr, w, r, kb, key);
+    else     rc6_setup(rkr, w, r, kb, key);
+    jit_entry(ke)(pt, ct, n);
+    for (j=0; j<n; j++) {
+        memcpy(e, pt + j*bpb, bpb);
+        if (rc5) rc5_encrypt(rkr, w, r, e, e);
+        else     rc6_encrypt(rkr, w, r, e, e);
+        if (memcmp(e, ct + j*bpb, bpb)) {
+            fail("encrypt", rc5, w, r, lanes, n);
+            break;
+        }
+    }
+    memcpy(dt, ct, n*bpb);
+    jit_entry(kd)(dt, dt, n);
+    if (memcmp(dt, pt, n*bpb)) fail("decrypt", rc5, w, r, lanes, n);
+    jit_free(ke);
+    jit_free(kd);
+    return 1;
+}
+
+int main(void) {
+    int w, rc5, i, runs = 0;
+    srand(1);
+    for (w=32; w<=64; w*=2)
+        for (rc5=0; rc5<2; rc5++)
+            for (i=0; i<TRIES; i++) runs += check(rc5, w, i);
+    if (runs == 0) {
+        printf("jit: no code generated on this platform\n");
+        return 0;
+    }
+    printf("jit: %d keys, %d failures\n", runs, bad);
+    return bad != 0;
+}
@@ -0,0 +1,169 @@
+/*
+// Check prp.c against a scalar reference built on rc6_ref.c's RC5.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Build and run with:
+ *
+ *   cc -O2 check_prp.c prp.c codebook.c executor.c rc6_wide.c \
+ *      rc6_ref.c -lpthread -o check_prp && ./check_prp
+ *
+ * The reference enciphers one value at a time as prp.h describes,
+ * with rc5_encrypt of (half, round | k<<8) as the round function, and
+ * cycle-walks. For small domains (tabulated and not, with n at and
+ * around powers of two), the iterator run to the end in random-sized
+ * steps must yield every value below n exactly once, agreeing with
+ * prp_at_n; for every n, prp_at, prp_at_n and an iterator from a
+ * random start must agree with the reference on random indices, up
+ * to n = 2^64-1. Prints the failures and exits nonzero if there are
+ * any.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rc6.h"
+#include "prp.h"
+
+#define FULL   (UINT64_C(1) << 20)  /* Check whole permutations below */
+#define SAMPLE 300          /* Random indices per key                */
+#define TRIES  6            /* Keys per n                            */
+
+static unsigned char rkr[4*(2*255+2)];
+static unsigned char *seen;
+static uint64_t buf[1000], at[1000], idx[SAMPLE], got[SAMPLE];
+
+static int bad;
+
+static void fail(const char *what, uint64_t n, int r) {
+    if (bad++ < 20)
+        printf("FAIL %s n=%llu r=%d\n", what, (unsigned long long)n, r);
+}
+
+static uint64_t rand64(void) {
+    uint64_t x = 0;
+    int i;
+    for (i=0; i<4; i++) x = x << 16 ^ (uint64_t)(rand() & 0xffff);
+    return x;
+}
+
+static uint32_t f(int r, uint32_t x, uint32_t tw) {
+    unsigned char b[8];
+    int i;
+    for (i=0; i<4; i++) {
+        b[i] = (unsigned char)(x >> 8*i);
+        b[4+i] = (unsigned char)(tw >> 8*i);
+    }
+    rc5_encrypt(rkr, 32, r, b, b);
+    return b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+/* pi(i) with the key in rkr                                       */
+static uint64_t reference(uint64_t n, int r, uint64_t i) {
+    int k = 2, lo, hi, j;
+    uint32_t mh, ml, h, l;
+    while (k < 64 && (UINT64_C(1) << k) < n) k++;
+    lo = k/2; hi = k - lo;
+    mh = (uint32_t)(~UINT64_C(0) >> (64 - hi));
+    ml = (uint32_t)(~UINT64_C(0) >> (64 - lo));
+    do {
+        h = (uint32_t)(i >> lo);
+        l = (uint32_t)i & ml;
+        for (j=0; j<10; j++) {
+            uint32_t tw = (uint32_t)(j | k << 8);
+            if (j & 1) l ^= f(r, h, tw) & ml;
+            else       h ^= f(r, l, tw) & mh;
+        }
+        i = (uint64_t)h << lo | l;
+    } while (i >= n);
+    return i;
+}
+
+static void check(uint64_t n) {
+    unsigned char key[32];
+    int r = rand() % 21, kb = rand() % 33;
+    size_t j, m;
+    uint64_t done, start;
+    prp p;
+    prp_iter it;
+    for (j=0; j<(size_t)kb; j++) key[j] = (unsigned char)rand();
+    if (prp_init(&p, n, r, kb, key)) {
+        fail("init", n, r);
+        return;
+    }
+    rc5_setup(rkr, 32, r, kb, key);
+    /* The whole permutation, in steps of 1 to 1000                */
+    if (n <= FULL) {
+        memset(seen, 0, (size_t)n);
+        prp_iter_init(&it, &p, 0);
+        done = 0;
+        while ((m = prp_iter_next(&it, buf, 1 + (size_t)rand() % 1000))) {
+            for (j=0; j<m; j++) at[j] = done + j;
+            prp_at_n(&p, at, at, m);
+            for (j=0; j<m; j++) {
+                if (buf[j] >= n || seen[buf[j]]++) {
+                    fail("permutation", n, r);
+                    goto sample;
+                }
+                if (buf[j] != at[j]) {
+                    fail("iterator", n, r);
+                    goto sample;
+                }
+            }
+            done += m;
+        }
+        if (done != n) fail("iterator length", n, r);
+    }
+sample:
+    /* Random indices, one at a time and together                  */
+    for (j=0; j<SAMPLE; j++) idx[j] = rand64() % n;
+    prp_at_n(&p, idx, got, SAMPLE);
+    for (j=0; j<SAMPLE; j++) {
+        uint64_t y = reference(n, r, idx[j]);
+        if (got[j] != y || prp_at(&p, idx[j]) != y) {
+            fail("prp_at_n/prp_at", n, r);
+            break;
+        }
+    }
+    /* An iterator from a random start, through the end when near  */
+    start = (rand() & 1 ? n - 1 - rand64() % (n < 2000 ? n : 2000)
+                        : rand64() % n);
+    prp_iter_init(&it, &p, start);
+    m = prp_iter_next(&it, buf, 1000);
+    if (m != (n - start < 1000 ? n - start : 1000))
+        fail("iterator count", n, r);
+    for (j=0; j<m; j++)
+        if (buf[j] != reference(n, r, start + j)) {
+            fail("iterator from start", n, r);
+            break;
+        }
+    if (n - start <= 1000 && prp_iter_next(&it, buf, 1000) != 0)
+        fail("iterator end", n, r);
+    prp_free(&p);
+}
+
+int main(void) {
+    static const uint64_t ns[] = {
+        1, 2, 3, 4, 5, 7, 8, 9, 1000, 65535, 65536, 65537, 100000,
+        FULL, UINT64_C(5000000000), UINT64_C(1) << 40,
+        (UINT64_C(1) << 40) + 1, UINT64_MAX
+    };
+    prp p;
+    int i, k, runs = 0;
+    srand(1);
+    if ((seen = (unsigned char *)malloc(FULL)) == NULL)
+        return 2;
+    for (i=0; i<(int)(sizeof(ns)/sizeof(ns[0])); i++)
+        for (k=0; k<TRIES; k++, runs++) check(ns[i]);
+    for (k=0; k<TRIES*10; k++, runs++) check(1 + rand64() % 300000);
+    if (prp_init(&p, 0, 12, 0, "") != -1) {
+        printf("FAIL prp_init with n = 0 is not -1\n");
+        bad++;
+    }
+    free(seen);
+    printf("prp: %d keys, %d failures\n", runs, bad);
+    return bad != 0;
+}
@@ -0,0 +1,122 @@
+/*
+// Check the tweakable RC6 of rc6.c against rc6_ref.c.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* rc6_ref.c is compiled into this program under other names, so it
+ * links against rc6.c for one word size at a time:
+ *
+ *   for w in 8 16 32 64 128; do
+ *     cc -O2 -DWORD_SZ=$w check_rc6t.c rc6.c -o check_rc6t &&
+ *     ./check_rc6t
+ *   done
+ *
+ * With random keys, tweaks and round counts (multiples of 4, as rc6.c
+ * needs), rc6t_encrypt and rc6t_decrypt must equal rc6_ref.c's, the n
+ * variants must equal single calls with T0 counting up, decryption
+ * must invert encryption, and with r > 0 a zero tweak must still
+ * differ from plain RC6 (injection j adds j). Prints the failures and
+ * exits nonzero if there are any.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rc6.h"
+
+#define rc5_setup     ref_rc5_setup
+#define rc5_encrypt   ref_rc5_encrypt
+#define rc5_decrypt   ref_rc5_decrypt
+#define rc6_setup     ref_rc6_setup
+#define rc6_encrypt   ref_rc6_encrypt
+#define rc6_decrypt   ref_rc6_decrypt
+#define rc6t_encrypt  ref_rc6t_encrypt
+#define rc6t_decrypt  ref_rc6t_decrypt
+#define rc6t_encryptn ref_rc6t_encryptn
+#define rc6t_decryptn ref_rc6t_decryptn
+#define vectors       ref_vectors
+#include "rc6_ref.c"
+#undef rc5_setup
+#undef rc5_encrypt
+#undef rc5_decrypt
+#undef rc6_setup
+#undef rc6_encrypt
+#undef rc6_decrypt
+#undef rc6t_encrypt
+#undef rc6t_decrypt
+#undef rc6t_encryptn
+#undef rc6t_decryptn
+#undef vectors
+
+#ifndef WORD_SZ
+#define WORD_SZ 64          /* rc6.c's default                       */
+#endif
+
+#define W     WORD_SZ
+#define BPB   (W/2)
+#define MAXN  64            /* Blocks per call, at most              */
+#define TRIES 200           /* Keys                                  */
+
+static unsigned char pt[MAXN*BPB], ct[MAXN*BPB], dt[MAXN*BPB];
+static unsigned char rk[(W/8)*(2*255+4)], rkr[(W/8)*(2*255+4)];
+
+static int bad;
+
+static void fail(const char *what, int r, size_t n) {
+    if (bad++ < 20)
+        printf("FAIL %s RC6-%d/%d tweaked, %zu blocks\n", what, W, r, n);
+}
+
+/* Add k to the little-endian word T0 at t (w/8 bytes)              */
+static void bump(unsigned char *t, unsigned k) {
+    int i;
+    for (i=0; i<W/8 && k; i++) {
+        k += t[i];
+        t[i] = (unsigned char)k;
+        k >>= 8;
+    }
+}
+
+static void check(int i) {
+    unsigned char key[32], tw[BPB/2], t1[BPB/2], e[BPB], e2[BPB];
+    int r = 4 * (i < 2 ? i*63 : rand() % 9), kb = rand() % 33;
+    size_t n = 1 + (size_t)rand() % MAXN, j;
+    for (j=0; j<(size_t)kb; j++) key[j] = (unsigned char)rand();
+    for (j=0; j<sizeof(tw); j++) tw[j] = (unsigned char)rand();
+    for (j=0; j<n*BPB; j++) pt[j] = (unsigned char)rand();
+    if (rc6_setup(rk, W, r, kb, key) || ref_rc6_setup(rkr, W, r, kb, key)) {
+        fail("setup", r, n);
+        return;
+    }
+    rc6t_encryptn(rk, W, r, tw, pt, ct, n);
+    for (j=0; j<n; j++) {
+        memcpy(t1, tw, sizeof(t1));
+        bump(t1, (unsigned)j);
+        rc6t_encrypt(rk, W, r, t1, pt + j*BPB, e);
+        ref_rc6t_encrypt(rkr, W, r, t1, pt + j*BPB, e2);
+        if (memcmp(e, e2, BPB)) { fail("encrypt", r, n); break; }
+        if (memcmp(e, ct + j*BPB, BPB)) { fail("encryptn", r, n); break; }
+        ref_rc6t_decrypt(rkr, W, r, t1, e2, e2);
+        rc6t_decrypt(rk, W, r, t1, e, e);
+        if (memcmp(e, e2, BPB) || memcmp(e, pt + j*BPB, BPB)) {
+            fail("decrypt", r, n);
+            break;
+        }
+    }
+    rc6t_decryptn(rk, W, r, tw, ct, dt, n);
+    if (memcmp(dt, pt, n*BPB)) fail("decryptn", r, n);
+    memset(t1, 0, sizeof(t1));
+    rc6t_encrypt(rk, W, r, t1, pt, e);
+    rc6_encrypt(rk, W, r, pt, e2);
+    if (r > 0 && !memcmp(e, e2, BPB)) fail("zero tweak", r, n);
+}
+
+int main(void) {
+    int i;
+    srand(1);
+    for (i=0; i<TRIES; i++) check(i);
+    printf("rc6t, w=%d: %d keys, %d failures\n", W, TRIES, bad);
+    return bad != 0;
+}
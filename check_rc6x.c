@@ -0,0 +1,129 @@
+/*
+// Check rc6_vec.c against rc6_ref.c.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Build with the vector size and target to check, eg:
+ *
+ *   cc -O2 -march=native check_rc6x.c rc6_vec.c rc6_wide.c \
+ *      rc6_ref.c modes.c -o check_rc6x && ./check_rc6x
+ *
+ *   s390x-linux-gnu-gcc -O2 -march=z14 -static check_rc6x.c \
+ *      rc6_vec.c rc6_wide.c rc6_ref.c modes.c -o check_rc6x &&
+ *   qemu-s390x ./check_rc6x
+ *
+ * and again with -DRC6X_VEC_BYTES=16 or 32. A big-endian target such
+ * as s390x or ppc64 covers the byte-order-neutral load and store.
+ *
+ * For RC6 and RC5 at w = 8, 16, 32 and 64, with random keys, round
+ * counts and block counts, every block of rc6x/rc5x_encrypt must
+ * equal rc6_ref.c's encryption of it, and decryption must give the
+ * plaintext back. CTR, CFB and CBC decryption through
+ * blkcipher_rc6x/rc5x must match the same blkcipher with no encn or
+ * decn. Prints the failures and exits
+ * nonzero if there are any.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rc6.h"
+#include "modes.h"
+#include "rc6_wide.h"
+#include "rc6_vec.h"
+
+#define MAXN  300           /* Blocks per call, at most              */
+#define TRIES 200           /* Keys per w and cipher                 */
+
+static unsigned char pt[MAXN*32], ct[MAXN*32], dt[MAXN*32];
+static unsigned char a[MAXN*32], b[MAXN*32];
+static uint64_t rkx[2*255+4];
+static unsigned char rkr[8*(2*255+4)];
+
+static int bad;
+
+static void fail(const char *what, int rc5, int w, int r, size_t n) {
+    if (bad++ < 20)
+        printf("FAIL %s RC%d-%d/%d, %zu blocks\n", what, rc5 ? 5 : 6,
+               w, r, n);
+}
+
+/* One random key: kernel against reference, then the modes        */
+static void check(int rc5, int w) {
+    unsigned char key[32], e[32], iv1[32], iv2[32];
+    int r = rand() % 33, kb = rand() % 33, bpb = (rc5 ? w/4 : w/2), s;
+    size_t n = (size_t)rand() % (MAXN+1), j, len;
+    blkcipher bx, bs;
+    for (j=0; j<(size_t)kb; j++) key[j] = (unsigned char)rand();
+    for (j=0; j<n*bpb; j++) pt[j] = (unsigned char)rand();
+    if (rc5) {
+        rc5w_setup(rkx, w, r, kb, key);
+        rc5_setup(rkr, w, r, kb, key);
+        rc5x_encrypt(rkx, w, r, pt, ct, n);
+        rc5x_decrypt(rkx, w, r, ct, dt, n);
+        blkcipher_rc5x(&bx, rkx, w, r);
+    } else {
+        rc6w_setup(rkx, w, r, kb, key);
+        rc6_setup(rkr, w, r, kb, key);
+        rc6x_encrypt(rkx, w, r, pt, ct, n);
+        rc6x_decrypt(rkx, w, r, ct, dt, n);
+        blkcipher_rc6x(&bx, rkx, w, r);
+    }
+    for (j=0; j<n; j++) {
+        memcpy(e, pt + j*bpb, bpb);
+        if (rc5) rc5_encrypt(rkr, w, r, e, e);
+        else     rc6_encrypt(rkr, w, r, e, e);
+        if (memcmp(e, ct + j*bpb, bpb)) {
+            fail("encrypt", rc5, w, r, n);
+            break;
+        }
+    }
+    if (memcmp(dt, pt, n*bpb)) fail("decrypt", rc5, w, r, n);
+    /* Lengths need not be whole blocks for CTR and CFB             */
+    bs = bx;
+    bs.encn = bs.decn = NULL;
+    bs.lanes = 0;
+    len = (n > 0 ? (size_t)rand() % (n*bpb) + 1 : 0);
+    memset(iv1, 7, sizeof(iv1));
+    memcpy(iv2, iv1, sizeof(iv2));
+    ctr_crypt(&bx, iv1, pt, a, len);
+    ctr_crypt(&bs, iv2, pt, b, len);
+    if (memcmp(a, b, len) || memcmp(iv1, iv2, bpb))
+        fail("ctr", rc5, w, r, n);
+    s = 1 + rand() % bpb;
+    memcpy(iv1, iv2, sizeof(iv1));
+    cfb_decrypt(&bx, s, iv1, pt, a, len);
+    cfb_decrypt(&bs, s, iv2, pt, b, len);
+    if (memcmp(a, b, len) || memcmp(iv1, iv2, bpb))
+        fail("cfb", rc5, w, r, n);
+    /* CBC decryption batches through decn, here in place          */
+    len = n*bpb;
+    memcpy(iv1, iv2, sizeof(iv1));
+    cbc_encrypt(&bs, iv1, pt, a, len);
+    memcpy(b, a, len);
+    memcpy(iv1, iv2, sizeof(iv1));
+    cbc_decrypt(&bx, iv1, a, a, len);
+    cbc_decrypt(&bs, iv2, b, b, len);
+    if (memcmp(a, pt, len) || memcmp(b, pt, len) || memcmp(iv1, iv2, bpb))
+        fail("cbc", rc5, w, r, n);
+}
+
+int main(void) {
+    int w, rc5, i, runs = 0;
+    srand(1);
+    for (w=8; w<=64; w*=2) {
+        if (!rc6x_supported(w)) {
+            printf("FAIL rc6x_supported(%d) is 0\n", w);
+            bad++;
+            continue;
+        }
+        for (rc5=0; rc5<2; rc5++)
+            for (i=0; i<TRIES; i++, runs++) check(rc5, w);
+    }
+    printf("rc6x, %d-byte vectors: %d keys, %d failures\n",
+           RC6X_VEC_BYTES, runs, bad);
+    return bad != 0;
+}
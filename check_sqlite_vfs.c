@@ -0,0 +1,203 @@
+/*
+// Check sqlite_vfs.c: a database and its WAL round-trip through the VFS.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Build and run with:
+ *
+ *   cc -O2 check_sqlite_vfs.c sqlite_vfs.c rc6_wide.c rc6_vert.c \
+ *      transpose.c modes.c rc6_ref.c -lsqlite3 -o check_sqlite_vfs &&
+ *   ./check_sqlite_vfs
+ *
+ * For w = 1024 (8 blocks a page, one rc6w call each) and 128 and 64
+ * (whole pages through the rc6_vert.c kernels), a WAL database is filled over
+ * several transactions that rewrite the same pages, then read back
+ * through a second connection, from a copy of the files (so that WAL
+ * recovery must find the decrypted frame checksums valid) and after
+ * a checkpoint. Neither file may hold a row in the clear, and a
+ * frame header read through the VFS must match the raw file except
+ * for its checksums. A wrong key must not read the copy. The files
+ * go in /tmp. Prints the failures and exits nonzero if there are any.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sqlite3.h>
+#include "sqlite_vfs.h"
+
+#define PAGE  4096
+#define ROWS  300           /* Rows, each rewritten TXNS times       */
+#define TXNS  4
+#define DB    "/tmp/check_sqlite_vfs.db"
+#define COPY  "/tmp/check_sqlite_vfs.copy"
+
+static unsigned char raw[4 << 20];
+
+static int bad;
+
+static void fail(const char *what, int w) {
+    if (bad++ < 20)
+        printf("FAIL %s, w=%d\n", what, w);
+}
+
+static void unlink_db(const char *path) {
+    char name[64];
+    remove(path);
+    sprintf(name, "%s-wal", path); remove(name);
+    sprintf(name, "%s-shm", path); remove(name);
+}
+
+/* Bytes of file path in raw, or -1                                */
+static long slurp(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    long n;
+    if (fp == NULL) return -1;
+    n = (long)fread(raw, 1, sizeof(raw), fp);
+    fclose(fp);
+    return n;
+}
+
+/* Nonzero if the raw bytes of path hold the text of any row        */
+static int plaintext(const char *path) {
+    long n = slurp(path), i;
+    for (i=0; i+7<=n; i++)
+        if (memcmp(raw+i, "marker-", 7) == 0) return 1;
+    return 0;
+}
+
+static int copy(const char *from, const char *to) {
+    FILE *fp;
+    long n = slurp(from);
+    if (n < 0 || (fp = fopen(to, "wb")) == NULL) return -1;
+    fwrite(raw, 1, (size_t)n, fp);
+    return fclose(fp);
+}
+
+static int exec(sqlite3 *db, const char *sql) {
+    return sqlite3_exec(db, sql, NULL, NULL, NULL);
+}
+
+static sqlite3 *open_db(const char *path, const char *vfs) {
+    sqlite3 *db;
+    if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READWRITE |
+                        SQLITE_OPEN_CREATE, vfs) != SQLITE_OK) {
+        sqlite3_close(db);
+        return NULL;
+    }
+    exec(db, "PRAGMA temp_store=MEMORY");
+    return db;
+}
+
+/* Nonzero unless db holds every row as the last transaction left it */
+static int verify(sqlite3 *db) {
+    sqlite3_stmt *st;
+    char want[64];
+    int k = 0, rc;
+    if (db == NULL || sqlite3_prepare_v2(db, "SELECT k, v FROM t ORDER BY k",
+                                         -1, &st, NULL) != SQLITE_OK)
+        return 1;
+    while ((rc = sqlite3_step(st)) == SQLITE_ROW) {
+        sprintf(want, "marker-%d-%d", k, TXNS-1);
+        if (sqlite3_column_int(st, 0) != k ||
+            strcmp((const char *)sqlite3_column_text(st, 1), want))
+            break;
+        k++;
+    }
+    sqlite3_finalize(st);
+    return rc != SQLITE_DONE || k != ROWS;
+}
+
+/* The first frame header of the WAL at path, through vfs and raw:
+ * the salts and page number must match, the checksums differ       */
+static void frame_header(sqlite3_vfs *vfs, const char *path, int w) {
+    sqlite3_file *pf = (sqlite3_file *)calloc(1, vfs->szOsFile);
+    unsigned char hdr[24];
+    int fl;
+    if (pf == NULL) return;
+    if (vfs->xOpen(vfs, path, pf, SQLITE_OPEN_WAL | SQLITE_OPEN_READONLY,
+                   &fl) != SQLITE_OK ||
+        pf->pMethods->xRead(pf, hdr, 24, 32) != SQLITE_OK)
+        fail("frame header read", w);
+    else if (slurp(path) < 56 || memcmp(hdr, raw+32, 16) ||
+             memcmp(hdr+16, raw+48, 8) == 0)
+        fail("frame header", w);
+    if (pf->pMethods) pf->pMethods->xClose(pf);
+    free(pf);
+}
+
+static void check(int w) {
+    unsigned char key[32];
+    char name[32], bad_name[32], sql[128];
+    sqlite3 *db, *db2;
+    sqlite3_vfs *vfs;
+    int i, j;
+    for (i=0; i<32; i++) key[i] = (unsigned char)rand();
+    sprintf(name, "rc6-%d", w);
+    sprintf(bad_name, "rc6-%d-bad", w);
+    if (rc6vfs_register(name, NULL, w, 20, key, 32, PAGE, 0) ||
+        (vfs = sqlite3_vfs_find(name)) == NULL) {
+        fail("register", w);
+        return;
+    }
+    key[0] ^= 1;
+    rc6vfs_register(bad_name, NULL, w, 20, key, 32, PAGE, 0);
+    unlink_db(DB); unlink_db(COPY);
+    if ((db = open_db(DB, name)) == NULL ||
+        exec(db, "PRAGMA page_size=4096") ||
+        exec(db, "PRAGMA journal_mode=MEMORY") ||
+        exec(db, "PRAGMA journal_mode=WAL") ||
+        exec(db, "PRAGMA wal_autocheckpoint=0") ||
+        exec(db, "CREATE TABLE t(k INTEGER PRIMARY KEY, v TEXT)")) {
+        fail("create", w);
+        sqlite3_close(db);
+        return;
+    }
+    for (j=0; j<TXNS; j++) {
+        exec(db, "BEGIN");
+        for (i=0; i<ROWS; i++) {
+            sprintf(sql, "INSERT OR REPLACE INTO t VALUES(%d, "
+                    "'marker-%d-%d')", i, i, j);
+            if (exec(db, sql)) fail("insert", w);
+        }
+        if (exec(db, "COMMIT")) fail("commit", w);
+    }
+    db2 = open_db(DB, name);
+    if (verify(db2)) fail("read from the WAL", w);
+    sqlite3_close(db2);
+    if (plaintext(DB "-wal")) fail("plaintext in the WAL", w);
+    frame_header(vfs, DB "-wal", w);
+    if (copy(DB, COPY) || copy(DB "-wal", COPY "-wal")) {
+        fail("copy", w);
+    } else {
+        db2 = open_db(COPY, name);
+        if (verify(db2)) fail("read after WAL recovery", w);
+        sqlite3_close(db2);
+        db2 = open_db(COPY, bad_name);
+        if (db2 && verify(db2) == 0) fail("read with a wrong key", w);
+        sqlite3_close(db2);
+    }
+    if (exec(db, "PRAGMA wal_checkpoint(TRUNCATE)"))
+        fail("checkpoint", w);
+    sqlite3_close(db);
+    if (plaintext(DB)) fail("plaintext in the database", w);
+    db = open_db(DB, name);
+    if (verify(db)) fail("read after checkpoint", w);
+    sqlite3_close(db);
+    unlink_db(DB); unlink_db(COPY);
+}
+
+int main(void) {
+    srand(1);
+    check(1024);
+    check(128);
+    check(64);
+    if (rc6vfs_register("rc6-bad", NULL, 32, 20, "k", 1, PAGE, 0) == 0) {
+        printf("FAIL rc6vfs_register with w=32 is SQLITE_OK\n");
+        bad++;
+    }
+    printf("sqlite_vfs: %d failures\n", bad);
+    return bad != 0;
+}
@@ -0,0 +1,158 @@
+/*
+// Check usage.c: epoch limits, totals and decryption under any epoch.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Build and run with:
+ *
+ *   cc -O2 check_usage.c usage.c rc6_ref.c rc6_wide.c kdf.c arena.c \
+ *      executor.c modes.c -lpthread -o check_usage && ./check_usage
+ *
+ * and with -fsanitize=thread for the races. For RC5-8, RC6-8, RC5-16,
+ * RC6-16 and RC6-32 at the default limit, THREADS threads encrypt
+ * messages of 1 to 3 blocks with CTR, each under the schedule of the
+ * epoch usage_acquire gives it. No epoch may have more than limit
+ * blocks, usage_stats must count the blocks acquired, and sampled
+ * messages must decrypt under usage_schedule of their epoch. Then
+ * USAGE_MAX_THREADS handles, with limit 4, each hold the schedule of
+ * an epoch of their own while acquiring the next (a full epoch per
+ * call), which must neither fail nor hang. Prints the failures and
+ * exits nonzero if there are any.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rc6.h"
+#include "usage.h"
+
+#define THREADS  8
+#define CALLS    20000      /* Messages per thread                   */
+#define MAXEPOCH (1 << 20)
+
+static usage *U;
+static int cipher, W;
+static uint64_t per[MAXEPOCH], acquired;
+
+static int bad;
+
+static void fail(const char *what) {
+    if (__atomic_fetch_add(&bad, 1, __ATOMIC_RELAXED) < 20)
+        printf("FAIL %s RC%d-%d\n", what, cipher, W);
+}
+
+static void *run(void *arg) {
+    unsigned seed = (unsigned)(size_t)arg;
+    unsigned char rk[4*(2*12+4)];
+    usage_thread *t = usage_attach(U);
+    int i;
+    if (t == NULL) {
+        fail("attach");
+        return NULL;
+    }
+    for (i=0; i<CALLS; i++) {
+        unsigned char c1[16], c2[16], pt[48], ct[48], dt[48];
+        size_t n = 1 + (size_t)(rand_r(&seed) % 3);
+        blkcipher bc, bd;
+        uint64_t e;
+        if (usage_acquire(t, n, &bc, &e)) {
+            fail("acquire");
+            continue;
+        }
+        memset(c1, i, sizeof(c1));
+        memcpy(c2, c1, sizeof(c2));
+        memset(pt, (int)seed, sizeof(pt));
+        ctr_crypt(&bc, c1, pt, ct, n*bc.bpb);
+        usage_release(t);
+        __atomic_fetch_add(&acquired, n, __ATOMIC_RELAXED);
+        if (e >= MAXEPOCH) {
+            fail("epoch count");
+            continue;
+        }
+        __atomic_fetch_add(&per[e], n, __ATOMIC_RELAXED);
+        if (i % 97 == 0) {
+            if (usage_schedule(U, e, rk)) {
+                fail("usage_schedule");
+                continue;
+            }
+            if (cipher == USAGE_RC6) blkcipher_rc6(&bd, rk, W, 12);
+            else                     blkcipher_rc5(&bd, rk, W, 12);
+            ctr_crypt(&bd, c2, ct, dt, n*bd.bpb);
+            if (memcmp(dt, pt, n*bd.bpb)) fail("decrypt");
+        }
+    }
+    usage_detach(t);
+    return NULL;
+}
+
+static void threads(int c, int w) {
+    pthread_t th[THREADS];
+    uint64_t limit, blocks, epoch, stalls, e;
+    int i;
+    cipher = c; W = w;
+    memset(per, 0, sizeof(per));
+    acquired = 0;
+    U = usage_create(c, w, 12, "master", 6, 16, 0, 0, NULL);
+    if (U == NULL) {
+        fail("create");
+        return;
+    }
+    limit = usage_default_limit(c == USAGE_RC6 ? 4*w : 2*w);
+    for (i=0; i<THREADS; i++)
+        pthread_create(&th[i], NULL, run, (void *)(size_t)(i+1));
+    for (i=0; i<THREADS; i++)
+        pthread_join(th[i], NULL);
+    usage_stats(U, &blocks, &epoch, &stalls);
+    if (blocks != acquired) fail("usage_stats blocks");
+    for (e=0; e<MAXEPOCH; e++)
+        if (per[e] > limit) {
+            fail("limit");
+            break;
+        }
+    printf("RC%d-%d: limit %llu, %llu blocks, %llu epochs, %llu stalls\n",
+           c, w, (unsigned long long)limit, (unsigned long long)blocks,
+           (unsigned long long)epoch + 1, (unsigned long long)stalls);
+    usage_destroy(U);
+}
+
+/* Every handle pins a different past epoch                        */
+static void held(void) {
+    usage_thread *t[USAGE_MAX_THREADS];
+    blkcipher bc;
+    uint64_t e, blocks, epoch, stalls;
+    int i, k;
+    cipher = USAGE_RC6; W = 32;
+    U = usage_create(USAGE_RC6, 32, 20, "m", 1, 16, 4, 0, NULL);
+    if (U == NULL) {
+        fail("create");
+        return;
+    }
+    for (i=0; i<USAGE_MAX_THREADS; i++)
+        if ((t[i] = usage_attach(U)) == NULL) {
+            fail("attach");
+            return;
+        }
+    for (k=0; k<3; k++)
+        for (i=0; i<USAGE_MAX_THREADS; i++)
+            if (usage_acquire(t[i], 4, &bc, &e)) fail("held acquire");
+    usage_stats(U, &blocks, &epoch, &stalls);
+    if (blocks != 3*4*USAGE_MAX_THREADS) fail("held blocks");
+    for (i=0; i<USAGE_MAX_THREADS; i++)
+        usage_detach(t[i]);
+    usage_destroy(U);
+}
+
+int main(void) {
+    threads(USAGE_RC5, 8);
+    threads(USAGE_RC6, 8);
+    threads(USAGE_RC5, 16);
+    threads(USAGE_RC6, 16);
+    threads(USAGE_RC6, 32);
+    held();
+    printf("usage: %d failures\n", bad);
+    return bad != 0;
+}
@@ -0,0 +1,170 @@
+/*
+// Whole-codebook tables for block ciphers of at most 16 bits.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - executor.c for the parallel build.
+ * - On x86 with GCC or Clang, target attributes and
+ *   __builtin_cpu_supports select the AVX2 gather at run time.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rc6_wide.h"
+#include "codebook.h"
+#include "probes.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_AVX2 1
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * T A B L E   C O N S T R U C T I O N
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+typedef struct {
+    cb_fn fn;
+    void *ctx;
+    uint16_t *enc;
+    uint32_t size;
+    int nt;
+    int bad[64];                        /* Task t's fn left 0..size-1 */
+} cb_job;
+
+/* Task t of nt: slice t of the domain                             */
+static void cb_task(void *arg, size_t t) {
+    cb_job *j = (cb_job *)arg;
+    uint32_t x, lo = (uint32_t)((uint64_t)j->size*t/j->nt),
+             hi = (uint32_t)((uint64_t)j->size*(t+1)/j->nt);
+    int bad = 0;
+    for (x=lo; x<hi; x++) {
+        uint32_t y = j->fn(j->ctx, x);
+        bad |= (y >= j->size);
+        j->enc[x] = (uint16_t)y;
+    }
+    j->bad[t] = bad;
+}
+
+int cb_build(codebook *cb, int bits, cb_fn fn, void *ctx, int nthreads,
+             executor *ex) {
+    cb_job job;
+    unsigned char *seen;
+    uint32_t x, size = (uint32_t)1 << bits;
+    int t, nt = (nthreads < 1 ? 1 : nthreads > 64 ? 64 : nthreads), bad = 0;
+    cb->enc = cb->dec = NULL;
+    if (bits < 1 || bits > 16) return -1;
+    cb->bits = bits;
+    /* One spare entry, so a 32-bit gather of the last one stays in */
+    cb->enc = (uint16_t *)calloc(size+1, sizeof(uint16_t));
+    cb->dec = (uint16_t *)calloc(size+1, sizeof(uint16_t));
+    seen = (unsigned char *)calloc(size, 1);
+    if (cb->enc == NULL || cb->dec == NULL || seen == NULL) {
+        free(seen); cb_free(cb);
+        return -1;
+    }
+    memset(&job, 0, sizeof(job));
+    job.fn = fn; job.ctx = ctx; job.enc = cb->enc;
+    job.size = size; job.nt = nt;
+    exec_for(ex, (size_t)nt, (size_t)size/nt*2, cb_task, &job);
+    for (t=0; t<nt; t++) bad |= job.bad[t];
+    /* Invert, and check no value was hit twice                    */
+    for (x=0; !bad && x<size; x++) {
+        bad |= seen[cb->enc[x]];
+        seen[cb->enc[x]] = 1;
+        cb->dec[cb->enc[x]] = (uint16_t)x;
+    }
+    free(seen);
+    if (bad) { cb_free(cb); return -1; }
+    return 0;
+}
+
+typedef struct { uint64_t rkey[RC5W_RKEY_BYTES(8, 255)/8]; int r; } rc5_8;
+
+static uint32_t rc5_8_fn(void *ctx, uint32_t x) {
+    rc5_8 *c = (rc5_8 *)ctx;
+    unsigned char b[2];
+    b[0] = (unsigned char)x; b[1] = (unsigned char)(x >> 8);
+    rc5w_encrypt(c->rkey, 8, c->r, b, b);
+    return (uint32_t)b[0] | (uint32_t)b[1] << 8;
+}
+
+int cb_rc5_8(codebook *cb, int r, int b, const void *key, int nthreads,
+             executor *ex) {
+    rc5_8 *c = (rc5_8 *)malloc(sizeof(rc5_8));
+    int ret = -1;
+    cb->enc = cb->dec = NULL;
+    if (c == NULL) return -1;
+    c->r = r;
+    if (rc5w_setup(c->rkey, 8, r, b, (void *)key) == 0)
+        ret = cb_build(cb, 16, rc5_8_fn, c, nthreads, ex);
+    memset(c, 0, sizeof(rc5_8));
+    free(c);
+    return ret;
+}
+
+void cb_free(codebook *cb) {
+    size_t n = ((size_t)1 << cb->bits) + 1;
+    if (cb->enc) { memset(cb->enc, 0, n*sizeof(uint16_t)); free(cb->enc); }
+    if (cb->dec) { memset(cb->dec, 0, n*sizeof(uint16_t)); free(cb->dec); }
+    cb->enc = cb->dec = NULL;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * B A T C H   L O O K U P
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifdef HAVE_AVX2
+static int use_avx2(void) {
+    static int have = -1;               /* Benign race: same answer */
+    if (have < 0) have = __builtin_cpu_supports("avx2") ? 1 : 0;
+    return have;
+}
+
+/* Sixteen lookups per pass: widen the indices to 32 bits, gather
+ * 32 bits at t+2*index (the spare entry keeps the last in bounds),
+ * keep the low halves and pack back in order.                     */
+__attribute__((target("avx2")))
+static size_t gather_avx2(const uint16_t *t, uint32_t mask,
+                          const uint16_t *in, uint16_t *out, size_t n) {
+    __m256i m = _mm256_set1_epi32((int)mask);
+    __m256i lo = _mm256_set1_epi32(0xffff);
+    size_t i;
+    for (i=0; i+16<=n; i+=16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(in+i));
+        __m256i a = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(x));
+        __m256i b = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(x, 1));
+        a = _mm256_i32gather_epi32((const int *)t, _mm256_and_si256(a, m), 2);
+        b = _mm256_i32gather_epi32((const int *)t, _mm256_and_si256(b, m), 2);
+        x = _mm256_packus_epi32(_mm256_and_si256(a, lo),
+                                _mm256_and_si256(b, lo));
+        x = _mm256_permute4x64_epi64(x, 0xd8);
+        _mm256_storeu_si256((__m256i *)(out+i), x);
+    }
+    return i;
+}
+#endif
+
+static void lookup(const codebook *cb, const uint16_t *t,
+                   const uint16_t *in, uint16_t *out, size_t n) {
+    uint32_t mask = ((uint32_t)1 << cb->bits) - 1;
+    size_t i = 0;
+#ifdef HAVE_AVX2
+    if (use_avx2()) i = gather_avx2(t, mask, in, out, n);
+#endif
+    PROBE3(dispatch, "codebook.avx2", i > 0, cb->bits);
+    for ( ; i<n; i++) out[i] = t[in[i] & mask];
+}
+
+void cb_encrypt_n(const codebook *cb, const uint16_t *in, uint16_t *out,
+                  size_t n) {
+    lookup(cb, cb->enc, in, out, n);
+}
+
+void cb_decrypt_n(const codebook *cb, const uint16_t *in, uint16_t *out,
+                  size_t n) {
+    lookup(cb, cb->dec, in, out, n);
+}
@@ -0,0 +1,54 @@
+/*
+// Whole-codebook tables for block ciphers of at most 16 bits.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* A cipher on bits-bit blocks is a permutation of 2^bits values, so
+ * for bits <= 16 both directions fit in two tables of at most 64K
+ * uint16_t each (256 KiB together), after which encrypting or
+ * decrypting is a single load: cb->enc[x] and cb->dec[y]. The batch
+ * functions gather with AVX2 when the CPU has it.
+ *
+ * RC5-8 has 16-bit blocks. Its codebook value for block bytes p[0],
+ * p[1] is enc[p[0] | p[1] << 8], matching the byte order of rc5w and
+ * rc6_ref.c. Building it costs 64K encryptions, split into nthreads
+ * tasks for an executor (executor.h).
+ */
+#ifndef CODEBOOK_H
+#define CODEBOOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "executor.h"
+
+typedef struct {
+    int bits;
+    uint16_t *enc, *dec;        /* 2^bits entries each, plus padding */
+} codebook;
+
+/* Permutation to tabulate; called concurrently from several threads */
+typedef uint32_t (*cb_fn)(void *ctx, uint32_t x);
+
+/* Fill cb with fn on 0..2^bits-1, 1 <= bits <= 16, in nthreads tasks
+ * on ex (NULL for exec_default()). Returns 0 on success, -1 for bad
+ * bits, memory failure, or an fn that is not a permutation.       */
+int cb_build(codebook *cb, int bits, cb_fn fn, void *ctx, int nthreads,
+             executor *ex);
+
+/* Codebook of RC5-8/r/b under key. Returns 0 on success.          */
+int cb_rc5_8(codebook *cb, int r, int b, const void *key, int nthreads,
+             executor *ex);
+
+/* Wipes and frees the tables                                      */
+void cb_free(codebook *cb);
+
+/* out[i] = enc[in[i]] (dec[in[i]]), inputs taken mod 2^bits. in and
+ * out may be equal.                                               */
+void cb_encrypt_n(const codebook *cb, const uint16_t *in, uint16_t *out,
+                  size_t n);
+void cb_decrypt_n(const codebook *cb, const uint16_t *in, uint16_t *out,
+                  size_t n);
+
+#endif
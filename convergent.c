@@ -0,0 +1,182 @@
+/*
+// Convergent (deterministic) chunk encryption for deduplication.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - POSIX threads (pthread_once) and executor.c.
+ * - rc6_wide.c, rc6_vert.c with transpose.c, and modes.c (which
+ *   needs an rc6.h implementation to link).
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "modes.h"
+#include "rc6_wide.h"
+#include "rc6_vert.h"
+#include "convergent.h"
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * C O N T E N T - D E F I N E D   C H U N K I N G
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Gear table: 256 fixed pseudo-random words, filled once.         */
+static uint64_t gear[256];
+static pthread_once_t gear_once = PTHREAD_ONCE_INIT;
+
+static void gear_init(void) {
+    uint64_t x = 0;
+    int i;
+    for (i=0; i<256; i++) {             /* splitmix64 stream        */
+        uint64_t z = (x += UINT64_C(0x9e3779b97f4a7c15));
+        z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+        z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+        gear[i] = z ^ (z >> 31);
+    }
+}
+
+/* Length of the chunk starting at p, at most len bytes. Bit k of the
+ * gear hash depends only on the last k+1 bytes, so the cut test uses
+ * the top bits and hashing can start 64 bytes before min_sz.      */
+static size_t cut(const conv_ctx *c, const unsigned char *p, size_t len) {
+    uint64_t h = 0, mask;
+    size_t i, lg = 0;
+    if (len <= c->min_sz) return len;
+    if (len > c->max_sz) len = c->max_sz;
+    while (((size_t)1 << lg) < c->avg_sz) lg++;
+    mask = ~UINT64_C(0) << (64 - lg);
+    i = (c->min_sz > 64 ? c->min_sz - 64 : 0);
+    for ( ; i < c->min_sz; i++) h = (h << 1) + gear[p[i]];
+    for ( ; i < len; i++) {
+        h = (h << 1) + gear[p[i]];
+        if ((h & mask) == 0) return i+1;
+    }
+    return len;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * C H U N K   K E Y S   A N D   E N C R Y P T I O N
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+typedef union {
+    unsigned char b[BLK_MAX]; unsigned long long a; long double d;
+} blkbuf;
+
+/* CBC-MAC with the length in the first block, so it is a PRF over
+ * variable-length input. The first keylen tag bytes are the key.  */
+static void chunk_key(const conv_ctx *c, const unsigned char *p,
+                      size_t len, unsigned char *key) {
+    blkbuf x;
+    size_t i, j, bpb = (size_t)c->w/2;
+    memset(x.b, 0, bpb);
+    for (i=0; i<8; i++) x.b[bpb-1-i] = (unsigned char)(len >> 8*i);
+    rc6w_encrypt(c->mac_rkey, c->w, c->r, x.b, x.b);
+    for (i=0; i<len; i+=bpb) {
+        for (j=0; j<bpb && i+j<len; j++) x.b[j] ^= p[i+j];
+        rc6w_encrypt(c->mac_rkey, c->w, c->r, x.b, x.b);
+    }
+    memcpy(key, x.b, (size_t)c->keylen);
+}
+
+/* rc6v pads a short batch to RC6V_LANES blocks, so chunks of fewer
+ * blocks than that run one rc6w block at a time                   */
+static void chunk_ctr(const conv_ctx *c, void *rkey, const conv_chunk *ch,
+                      const unsigned char *in, unsigned char *out) {
+    blkcipher bc;
+    blkbuf ctr;
+    memset(ctr.b, 0, (size_t)c->w/2);
+    rc6w_setup(rkey, c->w, c->r, c->keylen, (void *)ch->key);
+    blkcipher_rc6v(&bc, rkey, c->w, c->r);
+    if (!rc6v_supported(c->w) || ch->len < (size_t)RC6V_LANES*(c->w/2)) {
+        bc.encn = bc.decn = NULL;
+        bc.lanes = 0;
+    }
+    ctr_crypt(&bc, ctr.b, in, out, ch->len);
+}
+
+typedef struct {
+    const conv_ctx *c;
+    const unsigned char *in;
+    unsigned char *out;
+    conv_chunk *chunks;
+    unsigned char *rkeys;               /* One schedule per task    */
+    size_t rksz, n, step;
+} conv_job;
+
+/* Task t: chunks t, t+step, t+2*step, ... under schedule t        */
+static void conv_task(void *arg, size_t t) {
+    conv_job *j = (conv_job *)arg;
+    void *rkey = j->rkeys + t*j->rksz;
+    size_t i;
+    for (i=t; i<j->n; i+=j->step) {
+        conv_chunk *ch = j->chunks + i;
+        chunk_key(j->c, j->in + ch->off, ch->len, ch->key);
+        chunk_ctr(j->c, rkey, ch, j->in + ch->off, j->out + ch->off);
+    }
+}
+
+int conv_init(conv_ctx *c, int w, int r, const void *secret,
+              int secret_len, size_t avg_sz, int nthreads) {
+    if (avg_sz < 64 || (avg_sz & (avg_sz-1)) != 0 || w < 32 || w > 1024 ||
+        r < 0 || r > 255)
+        return -1;
+    c->mac_rkey = malloc(RC6W_RKEY_BYTES(w, r));
+    if (c->mac_rkey == NULL)
+        return -1;
+    if (rc6w_setup(c->mac_rkey, w, r, secret_len, (void *)secret)) {
+        free(c->mac_rkey);
+        return -1;
+    }
+    pthread_once(&gear_once, gear_init);
+    c->w = w; c->r = r;
+    c->keylen = (w/2 < CONV_KEY_MAX ? w/2 : CONV_KEY_MAX);
+    c->avg_sz = avg_sz; c->min_sz = avg_sz/4; c->max_sz = avg_sz*4;
+    c->nthreads = (nthreads < 1 ? 1 : nthreads);
+    c->ex = NULL;
+    return 0;
+}
+
+void conv_free(conv_ctx *c) {
+    memset(c->mac_rkey, 0, RC6W_RKEY_BYTES(c->w, c->r));
+    free(c->mac_rkey);
+    c->mac_rkey = NULL;
+}
+
+size_t conv_encrypt(const conv_ctx *c, const void *in, void *out,
+                    size_t len, conv_chunk *chunks, size_t max_chunks) {
+    const unsigned char *p = (const unsigned char *)in;
+    size_t off, n = 0, rksz = RC6W_RKEY_BYTES(c->w, c->r);
+    conv_job job;
+    unsigned char *rkeys;
+    int nt = (c->nthreads < 64 ? c->nthreads : 64);
+    for (off=0; off<len && n<max_chunks; n++) {
+        chunks[n].off = off;
+        chunks[n].len = cut(c, p+off, len-off);
+        off += chunks[n].len;
+    }
+    if ((size_t)nt > n) nt = (n ? (int)n : 1);
+    if ((rkeys = (unsigned char *)malloc(nt*rksz)) == NULL)
+        return 0;
+    job.c = c; job.in = p; job.out = (unsigned char *)out;
+    job.chunks = chunks; job.rkeys = rkeys; job.rksz = rksz;
+    job.n = n; job.step = (size_t)nt;
+    exec_for(c->ex, (size_t)nt, off/nt, conv_task, &job);
+    memset(rkeys, 0, nt*rksz);
+    free(rkeys);
+    return n;
+}
+
+int conv_decrypt_chunk(const conv_ctx *c, const conv_chunk *ch,
+                       const void *in, void *out) {
+    void *rkey = malloc(RC6W_RKEY_BYTES(c->w, c->r));
+    if (rkey == NULL)
+        return -1;
+    chunk_ctr(c, rkey, ch, (const unsigned char *)in, (unsigned char *)out);
+    memset(rkey, 0, RC6W_RKEY_BYTES(c->w, c->r));
+    free(rkey);
+    return 0;
+}
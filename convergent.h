@@ -0,0 +1,66 @@
+/*
+// Convergent (deterministic) chunk encryption for deduplication.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Input is cut into content-defined chunks with a gear rolling hash,
+ * so an insertion only disturbs the chunks around it. Each chunk's
+ * key is a keyed CBC-MAC of its content under a convergence secret,
+ * and the chunk is encrypted with wide-block RC6 (rc6_wide.h) in CTR
+ * mode under that key with a zero counter. Identical chunks
+ * encrypted under the same secret thus give identical ciphertext,
+ * which is what dedup needs and also what leaks: equality of chunks
+ * is visible to anyone holding the ciphertext.
+ *
+ * Wide blocks (large w) mean fewer cipher calls per chunk. The CTR
+ * keystream of a chunk of RC6V_LANES blocks or more is made that
+ * many blocks at a time by rc6_vert.c, when it supports w; shorter
+ * chunks take one rc6w call per block. At w=1024 a 4 KiB chunk is 8
+ * blocks, and from avg_sz=16384 a typical chunk fills a batch.
+ */
+#ifndef CONVERGENT_H
+#define CONVERGENT_H
+
+#include <stddef.h>
+#include "executor.h"
+
+#define CONV_KEY_MAX 64     /* Chunk key is min(block bytes, this)   */
+
+typedef struct {
+    size_t off, len;                    /* Position in the input    */
+    unsigned char key[CONV_KEY_MAX];    /* Needed to decrypt        */
+} conv_chunk;
+
+typedef struct {
+    int w, r, keylen;
+    size_t min_sz, avg_sz, max_sz;      /* Chunk size bounds        */
+    int nthreads;                       /* Tasks per conv_encrypt   */
+    executor *ex;                       /* NULL: exec_default()     */
+    void *mac_rkey;                     /* Schedule of the secret   */
+} conv_ctx;
+
+/* conv_init returns 0 iff rc6_wide.h accepts w/r/secret_len and w
+ * is at least 32. avg_sz must be a power of two of at least 64;
+ * chunks are between avg_sz/4 and 4*avg_sz bytes. conv_encrypt
+ * splits its chunks into nthreads tasks for c->ex, which conv_init
+ * leaves NULL; set it to run them on another executor.
+ */
+int conv_init(conv_ctx *c, int w, int r, const void *secret,
+              int secret_len, size_t avg_sz, int nthreads);
+void conv_free(conv_ctx *c);
+
+/* Cut in[0..len-1] into chunks and encrypt them to out (same length).
+ * Returns the number of chunks written to chunks[]. If max_chunks is
+ * too small only the prefix described by chunks[] is processed.
+ * Returns 0 if scratch memory cannot be allocated.
+ */
+size_t conv_encrypt(const conv_ctx *c, const void *in, void *out,
+                    size_t len, conv_chunk *chunks, size_t max_chunks);
+
+/* Decrypt one chunk. in and out point at the chunk itself.        */
+int conv_decrypt_chunk(const conv_ctx *c, const conv_chunk *ch,
+                       const void *in, void *out);
+
+#endif
@@ -0,0 +1,326 @@
+/*
+// Pluggable task executor for the library's parallel work.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - POSIX threads and sysconf(_SC_NPROCESSORS_ONLN).
+ * - GCC or Clang __atomic builtins for the counters.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "executor.h"
+
+#define MAX_POOL 256        /* Threads per pool                      */
+
+struct task {
+    exec_task fn;
+    void *arg;
+};
+
+/* One thread's tasks: a ring that grows when full. The owner takes
+ * from the back, thieves from the front.                          */
+struct deque {
+    pthread_mutex_t mu;
+    struct task *t;
+    size_t head, count, cap;
+};
+
+struct pool {
+    executor ex;                /* First, so the handle is the pool */
+    int n, nq;                  /* Threads running, deques made     */
+    struct deque dq[MAX_POOL];
+    pthread_t tid[MAX_POOL];
+    size_t pending;             /* Queued in all deques             */
+    unsigned next;              /* Deque for outside submitters     */
+    int sleeping;
+    pthread_mutex_t mu;         /* For sleeping and waking only     */
+    pthread_cond_t cv;
+    int quit;
+};
+
+/* Which pool and deque the calling thread works for, if any        */
+struct worker {
+    struct pool *p;
+    int i;
+};
+
+static pthread_key_t worker_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+
+static void key_init(void) {
+    pthread_key_create(&worker_key, NULL);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * D E Q U E S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Append t; 0 if the ring could not grow                          */
+static int push(struct deque *d, struct task t) {
+    pthread_mutex_lock(&d->mu);
+    if (d->count == d->cap) {
+        size_t cap = (d->cap ? 2*d->cap : 64), i;
+        struct task *n = (struct task *)malloc(cap*sizeof(struct task));
+        if (n == NULL) {
+            pthread_mutex_unlock(&d->mu);
+            return 0;
+        }
+        for (i=0; i<d->count; i++) n[i] = d->t[(d->head + i) % d->cap];
+        free(d->t);
+        d->t = n; d->head = 0; d->cap = cap;
+    }
+    d->t[(d->head + d->count) % d->cap] = t;
+    d->count++;
+    pthread_mutex_unlock(&d->mu);
+    return 1;
+}
+
+/* Take the newest (back) or oldest task; 0 if empty               */
+static int pop(struct deque *d, int back, struct task *t) {
+    int got = 0;
+    pthread_mutex_lock(&d->mu);
+    if (d->count > 0) {
+        if (back) {
+            *t = d->t[(d->head + d->count - 1) % d->cap];
+        } else {
+            *t = d->t[d->head];
+            d->head = (d->head + 1) % d->cap;
+        }
+        d->count--;
+        got = 1;
+    }
+    pthread_mutex_unlock(&d->mu);
+    return got;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * P O O L
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Own newest task, else the oldest of the next deque that has one  */
+static int take(struct pool *p, int self, struct task *t) {
+    int k, n = __atomic_load_n(&p->n, __ATOMIC_ACQUIRE);
+    if (pop(&p->dq[self], 1, t)) return 1;
+    for (k=1; k<n; k++)
+        if (pop(&p->dq[(self + k) % n], 0, t)) return 1;
+    return 0;
+}
+
+static void *pool_thread(void *arg) {
+    struct worker *me = (struct worker *)arg;
+    struct pool *p = me->p;
+    struct task t;
+    pthread_setspecific(worker_key, me);
+    for (;;) {
+        if (take(p, me->i, &t)) {
+            __atomic_fetch_sub(&p->pending, 1, __ATOMIC_SEQ_CST);
+            t.fn(t.arg);
+            continue;
+        }
+        /* Announce sleep, then look again: a submitter bumps pending
+         * before reading sleeping, so one of the two sees the other */
+        pthread_mutex_lock(&p->mu);
+        __atomic_fetch_add(&p->sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&p->pending, __ATOMIC_SEQ_CST) == 0) {
+            if (p->quit) {
+                __atomic_fetch_sub(&p->sleeping, 1, __ATOMIC_SEQ_CST);
+                pthread_mutex_unlock(&p->mu);
+                break;
+            }
+            pthread_cond_wait(&p->cv, &p->mu);
+        }
+        __atomic_fetch_sub(&p->sleeping, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&p->mu);
+    }
+    free(me);
+    return NULL;
+}
+
+static void pool_submit(void *self, exec_task fn, void *arg, size_t cost) {
+    struct pool *p = (struct pool *)self;
+    struct worker *me = (struct worker *)pthread_getspecific(worker_key);
+    struct task t;
+    unsigned n = (unsigned)__atomic_load_n(&p->n, __ATOMIC_ACQUIRE);
+    int i;
+    if (me && me->p == p && cost > 0 && cost < EXEC_SMALL) {
+        fn(arg);
+        return;
+    }
+    i = (me && me->p == p ? me->i :
+         (int)(__atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED) % n));
+    t.fn = fn; t.arg = arg;
+    __atomic_fetch_add(&p->pending, 1, __ATOMIC_SEQ_CST);
+    if (!push(&p->dq[i], t)) {
+        __atomic_fetch_sub(&p->pending, 1, __ATOMIC_SEQ_CST);
+        fn(arg);
+        return;
+    }
+    if (__atomic_load_n(&p->sleeping, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&p->mu);
+        pthread_cond_signal(&p->cv);
+        pthread_mutex_unlock(&p->mu);
+    }
+}
+
+/* Free p, whose threads have exited                               */
+static void pool_free(struct pool *p) {
+    int i;
+    for (i=0; i<p->nq; i++) {
+        free(p->dq[i].t);
+        pthread_mutex_destroy(&p->dq[i].mu);
+    }
+    pthread_cond_destroy(&p->cv);
+    pthread_mutex_destroy(&p->mu);
+    free(p);
+}
+
+executor *exec_pool_create(int nthreads) {
+    struct pool *p;
+    struct worker *w;
+    int i, nt = (nthreads < 1 ? 1 : nthreads > MAX_POOL ? MAX_POOL
+                                                        : nthreads);
+    pthread_once(&key_once, key_init);
+    if ((p = (struct pool *)calloc(1, sizeof(struct pool))) == NULL)
+        return NULL;
+    p->ex.submit = pool_submit;
+    p->ex.self = p;
+    pthread_mutex_init(&p->mu, NULL);
+    pthread_cond_init(&p->cv, NULL);
+    for (i=0; i<nt; i++) pthread_mutex_init(&p->dq[i].mu, NULL);
+    p->nq = nt;
+    /* Threads that fail to start leave the work to the others     */
+    for (i=0; i<nt; i++) {
+        if ((w = (struct worker *)malloc(sizeof(struct worker))) == NULL)
+            break;
+        w->p = p; w->i = i;
+        if (pthread_create(&p->tid[i], NULL, pool_thread, w) != 0) {
+            free(w);
+            break;
+        }
+        /* Set before the next thread starts stealing              */
+        __atomic_store_n(&p->n, i+1, __ATOMIC_RELEASE);
+    }
+    if (p->n == 0) {
+        pool_free(p);
+        return NULL;
+    }
+    return &p->ex;
+}
+
+void exec_pool_destroy(executor *ex) {
+    struct pool *p;
+    int i;
+    if (ex == NULL) return;
+    p = (struct pool *)ex->self;
+    pthread_mutex_lock(&p->mu);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->cv);
+    pthread_mutex_unlock(&p->mu);
+    for (i=0; i<p->n; i++) pthread_join(p->tid[i], NULL);
+    pool_free(p);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * D E F A U L T
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+static executor *builtin, *chosen;
+static pthread_once_t builtin_once = PTHREAD_ONCE_INIT;
+
+/* Runs each task as it is submitted: the fallback with no threads  */
+static void inline_submit(void *self, exec_task fn, void *arg,
+                          size_t cost) {
+    (void)self; (void)cost;
+    fn(arg);
+}
+
+static executor inline_ex = { inline_submit, NULL };
+
+static void builtin_init(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    builtin = exec_pool_create(n < 1 ? 1 : (int)n);
+    if (builtin == NULL) builtin = &inline_ex;
+}
+
+executor *exec_default(void) {
+    executor *ex = __atomic_load_n(&chosen, __ATOMIC_ACQUIRE);
+    if (ex) return ex;
+    pthread_once(&builtin_once, builtin_init);
+    return builtin;
+}
+
+void exec_set_default(executor *ex) {
+    __atomic_store_n(&chosen, ex, __ATOMIC_RELEASE);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * P A R A L L E L   L O O P S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Shared by the caller and the tasks it submitted; freed by the last
+ * one out, which may be a task the executor runs after exec_for has
+ * returned.                                                       */
+struct loop {
+    void (*fn)(void *ctx, size_t i);
+    void *ctx;
+    size_t n, next, done;
+    size_t refs;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+};
+
+static void loop_run(struct loop *l) {
+    size_t i;
+    while ((i = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED)) < l->n) {
+        l->fn(l->ctx, i);
+        if (__atomic_add_fetch(&l->done, 1, __ATOMIC_ACQ_REL) == l->n) {
+            pthread_mutex_lock(&l->mu);
+            pthread_cond_broadcast(&l->cv);
+            pthread_mutex_unlock(&l->mu);
+        }
+    }
+}
+
+static void loop_put(struct loop *l) {
+    if (__atomic_sub_fetch(&l->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        pthread_cond_destroy(&l->cv);
+        pthread_mutex_destroy(&l->mu);
+        free(l);
+    }
+}
+
+static void loop_task(void *arg) {
+    struct loop *l = (struct loop *)arg;
+    loop_run(l);
+    loop_put(l);
+}
+
+void exec_for(executor *ex, size_t n, size_t cost,
+              void (*fn)(void *ctx, size_t i), void *ctx) {
+    struct loop *l;
+    size_t i;
+    if (n > 1 && (l = (struct loop *)malloc(sizeof(struct loop)))) {
+        if (ex == NULL) ex = exec_default();
+        l->fn = fn; l->ctx = ctx;
+        l->n = n; l->next = l->done = 0;
+        l->refs = n;
+        pthread_mutex_init(&l->mu, NULL);
+        pthread_cond_init(&l->cv, NULL);
+        for (i=1; i<n; i++) ex->submit(ex->self, loop_task, l, cost);
+        loop_run(l);
+        pthread_mutex_lock(&l->mu);
+        while (__atomic_load_n(&l->done, __ATOMIC_ACQUIRE) < n)
+            pthread_cond_wait(&l->cv, &l->mu);
+        pthread_mutex_unlock(&l->mu);
+        loop_put(l);
+        return;
+    }
+    for (i=0; i<n; i++) fn(ctx, i);
+}
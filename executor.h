@@ -0,0 +1,60 @@
+/*
+// Pluggable task executor for the library's parallel work.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* The library starts no threads of its own for bulk work. Parallel
+ * encryption (convergent.c), table building (codebook.c), readahead
+ * (uffd.c) and background key setup (usage.c) are split into tasks
+ * handed to an executor, a submit callback the application can point
+ * at the pool it already runs (TBB, folly, a libdispatch queue), so
+ * crypto work shares its threads instead of oversubscribing them.
+ *
+ * submit(self, fn, arg, cost) must arrange for fn(arg) to run once,
+ * on any thread, now or later; it may run it before returning. cost
+ * is a hint of the work in the task, in bytes processed, 0 when not
+ * known. Tasks never block on each other, so any pool works,
+ * including one with a single thread.
+ *
+ * Without an executor of its own, work goes to exec_default(): what
+ * exec_set_default installed, else a work-stealing pool of one thread
+ * per online CPU started on first use. Each of its threads keeps a
+ * deque of tasks, runs its own newest first and steals the oldest of
+ * others when idle; tasks of under EXEC_SMALL bytes submitted from a
+ * pool thread run there at once.
+ */
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <stddef.h>
+
+#define EXEC_SMALL 16384    /* Bytes below which a pool runs inline  */
+
+typedef void (*exec_task)(void *arg);
+
+typedef struct {
+    void (*submit)(void *self, exec_task fn, void *arg, size_t cost);
+    void *self;
+} executor;
+
+/* The executor used when none is given, and a way to replace it for
+ * the whole process (NULL restores the built-in pool). Set it before
+ * using the library from several threads.                         */
+executor *exec_default(void);
+void exec_set_default(executor *ex);
+
+/* A work-stealing pool of nthreads threads (at least 1), or NULL if
+ * none can be started. Destroying it runs what is queued first.   */
+executor *exec_pool_create(int nthreads);
+void exec_pool_destroy(executor *ex);
+
+/* Run fn(ctx, i) for i in 0..n-1 and return when all are done. The
+ * caller runs tasks too, so this finishes even while the executor is
+ * busy. Each i runs exactly once, so per-i scratch (eg, a schedule
+ * buffer per task) needs no locking. ex NULL means exec_default(). */
+void exec_for(executor *ex, size_t n, size_t cost,
+              void (*fn)(void *ctx, size_t i), void *ctx);
+
+#endif
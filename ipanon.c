@@ -0,0 +1,229 @@
+/*
+// Prefix-preserving IP address anonymization (Crypto-PAn style) with
+// small-word RC6 as the PRF.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - rc6_wide.c for the schedule and rc6_vec.c for the PRF.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rc6_wide.h"
+#include "rc6_vec.h"
+#include "ipanon.h"
+
+#define GROUP 32            /* Addresses per PRF batch               */
+#define MAXQ (128 + 64)     /* PRF inputs per address: bits + nodes  */
+
+/* A prefix p of even length. f bit 0 is f(p), bit 1+b is f(p||b).
+ * child[2*b0+b1] is the node of p||b0||b1, or 0 if not stored.    */
+struct node {
+    uint32_t child[4];
+    unsigned char f;
+};
+
+struct ipanon {
+    int w, r, bpb, cache_bits;
+    uint64_t *rkey;                 /* rc6w_setup schedule          */
+    unsigned char pad[16];          /* E(0): PRF input after prefix */
+    struct node *node;              /* node[0] is the empty prefix  */
+    size_t nnodes, cap, max_nodes;
+    unsigned char *blk;             /* GROUP*MAXQ PRF blocks        */
+};
+
+static int bit(const unsigned char *a, int i) {
+    return a[i>>3] >> (7 - (i&7)) & 1;
+}
+
+/* Encipher n blocks of a->bpb bytes in place                      */
+static void prf(ipanon *a, unsigned char *b, size_t n) {
+    rc6x_encrypt(a->rkey, a->w, a->r, b, b, n);
+}
+
+/* PRF input for the first i bits of addr, then flip (0 or 1) as
+ * bit i when flip >= 0, then the pad                              */
+static void input(const ipanon *a, unsigned char *b,
+                  const unsigned char *addr, int i, int flip) {
+    int n = i >> 3, m = i & 7;
+    memcpy(b, a->pad, a->bpb);
+    memcpy(b, addr, n);
+    if (m) b[n] = (addr[n] & (0xff00 >> m)) | (a->pad[n] & (0xff >> m));
+    if (flip >= 0) {
+        b[n] &= ~(0x80 >> m);
+        b[n] |= flip << (7-m);
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * T R I E
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Index of a new node, or 0 if the trie is full                   */
+static uint32_t new_node(ipanon *a) {
+    if (a->nnodes == a->max_nodes)
+        return 0;
+    if (a->nnodes == a->cap) {
+        size_t cap = a->cap ? 2*a->cap : 1024;
+        struct node *p;
+        if (cap > a->max_nodes) cap = a->max_nodes;
+        p = (struct node *)realloc(a->node, cap*sizeof(struct node));
+        if (p == NULL) return 0;
+        a->node = p; a->cap = cap;
+    }
+    memset(a->node + a->nnodes, 0, sizeof(struct node));
+    return (uint32_t)a->nnodes++;
+}
+
+/* Fill flips with the cached f bits of addr; return how many there
+ * are (even) and the last node on the path in *last.              */
+static int walk(const ipanon *a, const unsigned char *addr, int lim,
+                unsigned char *flips, uint32_t *last) {
+    uint32_t cur = 0;
+    int d = 0;
+    *last = 0;
+    if (lim == 0) return 0;
+    for (;;) {
+        const struct node *nd = a->node + cur;
+        int b0 = bit(addr, d);
+        flips[d>>3] |= (nd->f & 1) << (7 - (d&7));
+        flips[d>>3] |= (nd->f >> (1+b0) & 1) << (6 - (d&7));
+        *last = cur;
+        d += 2;
+        if (d >= lim) return d;
+        cur = nd->child[2*b0 + bit(addr, d-1)];
+        if (cur == 0) return d;
+    }
+}
+
+/* Store nodes for prefixes known..lim-2 of addr below last. out
+ * holds the PRF bits of prefixes known.., then the extra ones.    */
+static void grow(ipanon *a, const unsigned char *addr, int known,
+                 int lim, int nbits, uint32_t last,
+                 const unsigned char *out) {
+    int i, bpb = a->bpb;
+    for (i=known; i<lim; i+=2) {
+        int b0 = bit(addr, i), idx = 2*bit(addr, i-2) + bit(addr, i-1);
+        uint32_t n = a->node[last].child[idx];
+        if (n == 0) {
+            struct node *nd;
+            if ((n = new_node(a)) == 0) return;
+            nd = a->node + n;
+            nd->f = out[(i-known)*bpb] >> 7;
+            nd->f |= (out[(i+1-known)*bpb] >> 7) << (1+b0);
+            nd->f |= (out[(nbits-known + (i-known)/2)*bpb] >> 7) << (2-b0);
+            a->node[last].child[idx] = n;
+        }
+        last = n;
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * A N O N Y M I Z A T I O N
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+static void anon(ipanon *a, int nbits, const unsigned char *in,
+                 unsigned char *out, size_t n) {
+    int nb = nbits/8, bpb = a->bpb;
+    int lim = (a->cache_bits < nbits ? a->cache_bits : nbits);
+    size_t g;
+    for (g=0; g<n; g+=GROUP) {
+        unsigned char flips[GROUP][16];
+        int known[GROUP];
+        uint32_t last[GROUP];
+        size_t qs[GROUP + 1];
+        int j, i, m = (int)(n-g < GROUP ? n-g : GROUP);
+        unsigned char *q = a->blk;
+        memset(flips, 0, sizeof(flips));
+        /* Queue the PRF inputs the trie does not have            */
+        for (j=0; j<m; j++) {
+            const unsigned char *addr = in + (g+j)*nb;
+            known[j] = walk(a, addr, lim, flips[j], &last[j]);
+            qs[j] = (size_t)(q - a->blk) / bpb;
+            for (i=known[j]; i<nbits; i++, q+=bpb)
+                input(a, q, addr, i, -1);
+            for (i=known[j]; i<lim; i+=2, q+=bpb)
+                input(a, q, addr, i, !bit(addr, i));
+        }
+        qs[m] = (size_t)(q - a->blk) / bpb;
+        prf(a, a->blk, qs[m]);
+        /* Collect the bits, store new prefixes, apply            */
+        for (j=0; j<m; j++) {
+            const unsigned char *addr = in + (g+j)*nb;
+            const unsigned char *o = a->blk + qs[j]*bpb;
+            for (i=known[j]; i<nbits; i++)
+                flips[j][i>>3] |= (o[(i-known[j])*bpb] >> 7) << (7-(i&7));
+            if (known[j] > 0)
+                grow(a, addr, known[j], lim, nbits, last[j], o);
+            for (i=0; i<nb; i++)
+                out[(g+j)*nb + i] = addr[i] ^ flips[j][i];
+        }
+    }
+}
+
+ipanon *ipanon_create(int w, int r, const void *key, int keylen,
+                      int cache_bits, size_t max_nodes) {
+    ipanon *a;
+    unsigned char z[3*16];
+    if ((w != 16 && w != 32) || r<0 || r>255 || keylen<0 || keylen>255)
+        return NULL;
+    if ((a = (ipanon *)calloc(1, sizeof(ipanon))) == NULL)
+        return NULL;
+    a->w = w; a->r = r; a->bpb = w/2;
+    a->cache_bits = (cache_bits < 0 ? 0 : cache_bits > 128 ? 128
+                                        : cache_bits & ~1);
+    a->max_nodes = (max_nodes > UINT32_MAX ? UINT32_MAX : max_nodes);
+    a->rkey = (uint64_t *)malloc(RC6W_RKEY_BYTES(w, r));
+    a->blk = (unsigned char *)malloc((size_t)GROUP*MAXQ*a->bpb);
+    if (a->rkey == NULL || a->blk == NULL) {
+        ipanon_destroy(a);
+        return NULL;
+    }
+    rc6w_setup(a->rkey, w, r, keylen, (void *)key);
+    prf(a, a->pad, 1);
+    /* The root holds f of the empty prefix and of "0" and "1"; if
+     * it cannot be had, run without the cache                     */
+    if (a->cache_bits && a->max_nodes)
+        new_node(a);
+    if (a->nnodes) {
+        input(a, z, a->pad, 0, -1);
+        input(a, z+a->bpb, a->pad, 0, 0);
+        input(a, z+2*a->bpb, a->pad, 0, 1);
+        prf(a, z, 3);
+        a->node[0].f = (z[0] >> 7) | (z[a->bpb] >> 7) << 1 |
+                       (z[2*a->bpb] >> 7) << 2;
+    } else
+        a->cache_bits = 0;
+    return a;
+}
+
+void ipanon_destroy(ipanon *a) {
+    if (a) {
+        if (a->rkey) {
+            memset(a->rkey, 0, RC6W_RKEY_BYTES(a->w, a->r));
+            free(a->rkey);
+        }
+        free(a->blk);
+        free(a->node);
+        memset(a, 0, sizeof(*a));
+        free(a);
+    }
+}
+
+int ipanon_v4(ipanon *a, const void *in, void *out, size_t n) {
+    anon(a, 32, (const unsigned char *)in, (unsigned char *)out, n);
+    return 0;
+}
+
+int ipanon_v6(ipanon *a, const void *in, void *out, size_t n) {
+    if (a->w == 16)
+        return -1;
+    anon(a, 128, (const unsigned char *)in, (unsigned char *)out, n);
+    return 0;
+}
+
+size_t ipanon_nodes(const ipanon *a) { return a->nnodes; }
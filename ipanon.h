@@ -0,0 +1,57 @@
+/*
+// Prefix-preserving IP address anonymization (Crypto-PAn style) with
+// small-word RC6 as the PRF.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Bit i of an anonymized n-bit address is bit i of the address xor
+ * f(first i bits), so two addresses sharing a k-bit prefix map to
+ * addresses sharing exactly a k-bit prefix. f is the top bit of one
+ * RC6 block whose input is the prefix followed by the rest of a
+ * secret pad, the encryption of the all-zero block, as in Crypto-PAn
+ * with RC6 in place of AES. Addresses are in network byte order and
+ * bit 0 is the top bit of the first byte.
+ *
+ * Each call gathers the PRF inputs of many addresses and enciphers
+ * them together with the multi-block kernels of rc6_vec.c. RC6-16
+ * (64-bit blocks) has room for IPv4 prefixes only; RC6-32 (128-bit
+ * blocks) handles both.
+ *
+ * f values of the first cache_bits bits are kept in a trie of up to
+ * max_nodes nodes. Each node stands for a prefix of even length and
+ * holds f of it and of its two one-bit extensions, so the walk moves
+ * two bits per step and busy prefixes (a /16, a /48) cost no PRF
+ * calls once seen. When the trie is full, new prefixes are computed
+ * but not stored. Results do not depend on the cache.
+ *
+ * The trie grows during calls, so an ipanon must not be used from
+ * several threads at once.
+ */
+#ifndef IPANON_H
+#define IPANON_H
+
+#include <stddef.h>
+
+typedef struct ipanon ipanon;
+
+/* w is 16 or 32, r and keylen 0..255. cache_bits is rounded down to
+ * an even number of at most 128; 0 disables the cache. Returns NULL
+ * on bad parameters or if memory cannot be had.
+ */
+ipanon *ipanon_create(int w, int r, const void *key, int keylen,
+                      int cache_bits, size_t max_nodes);
+void ipanon_destroy(ipanon *a);
+
+/* Anonymize n addresses of 4 (IPv4) or 16 (IPv6) bytes each from in
+ * to out; in and out may be equal. Return 0, or -1 for IPv6 with
+ * w=16.
+ */
+int ipanon_v4(ipanon *a, const void *in, void *out, size_t n);
+int ipanon_v6(ipanon *a, const void *in, void *out, size_t n);
+
+/* Trie nodes in use                                               */
+size_t ipanon_nodes(const ipanon *a);
+
+#endif
@@ -0,0 +1,375 @@
+/*
+// Run-time generated RC6/RC5 kernels for x86-64 with round keys as
+// immediate operands.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - x86-64 System V ABI and POSIX mmap/mprotect for code generation;
+ *   elsewhere every constructor returns NULL.
+ * - rc6_wide.c, used to expand the key before it is embedded.
+ *
+ * Register use in generated code: rdi = in, rsi = out, rcx = rotate
+ * count, [rsp] = blocks left. All other registers hold block words
+ * and temporaries, so callee-saved ones are pushed first.
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jit.h"
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include "rc6_wide.h"
+
+struct jit_kernel {
+    void *code;
+    size_t size;
+};
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * X 8 6 - 6 4   I N S T R U C T I O N   E N C O D I N G
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+       R8, R9, R10, R11, R12, R13, R14, R15 };
+
+typedef struct {
+    unsigned char *p;
+    size_t n, cap;
+    int fail;
+} buf;
+
+static void byte(buf *b, int x) {
+    if (b->n == b->cap) {
+        unsigned char *q = (unsigned char *)realloc(b->p, b->cap*2+4096);
+        if (q == NULL) { b->fail = 1; return; }
+        b->p = q; b->cap = b->cap*2+4096;
+    }
+    b->p[b->n++] = (unsigned char)x;
+}
+
+static void imm32(buf *b, uint32_t x) {
+    int i;
+    for (i=0; i<4; i++) byte(b, (int)(x >> 8*i) & 0xff);
+}
+
+/* REX prefix, omitted when it would be a plain 0x40               */
+static void rex(buf *b, int wide, int reg, int idx, int rm) {
+    int x = 0x40 | wide<<3 | (reg>>3)<<2 | (idx>>3)<<1 | (rm>>3);
+    if (x != 0x40) byte(b, x);
+}
+
+static void modrm(buf *b, int mod, int reg, int rm) {
+    byte(b, mod<<6 | (reg&7)<<3 | (rm&7));
+}
+
+/* op dst, src for the "op r/m, r" forms: mov, add, sub, xor       */
+static void rr(buf *b, int wide, int op, int dst, int src) {
+    rex(b, wide, src, 0, dst); byte(b, op); modrm(b, 3, src, dst);
+}
+#define MOV 0x89
+#define ADD 0x01
+#define SUB 0x29
+#define XOR 0x31
+
+static void imul(buf *b, int wide, int dst, int src) {
+    rex(b, wide, dst, 0, src); byte(b, 0x0f); byte(b, 0xaf);
+    modrm(b, 3, dst, src);
+}
+
+/* dst = 2*src + 1                                                 */
+static void lea21(buf *b, int wide, int dst, int src) {
+    rex(b, wide, dst, src, src); byte(b, 0x8d); modrm(b, 1, dst, 4);
+    byte(b, (src&7)<<3 | (src&7)); byte(b, 1);
+}
+
+/* Rotate r by an immediate or by cl; ext 0 = rol, 1 = ror         */
+static void rot_imm(buf *b, int wide, int ext, int r, int k) {
+    rex(b, wide, 0, 0, r); byte(b, 0xc1); modrm(b, 3, ext, r); byte(b, k);
+}
+static void rot_cl(buf *b, int wide, int ext, int r) {
+    rex(b, wide, 0, 0, r); byte(b, 0xd3); modrm(b, 3, ext, r);
+}
+
+/* mov r, [base+disp] and mov [base+disp], r                       */
+static void load(buf *b, int wide, int r, int base, int disp) {
+    rex(b, wide, r, 0, base); byte(b, 0x8b); modrm(b, 2, r, base);
+    imm32(b, (uint32_t)disp);
+}
+static void store(buf *b, int wide, int base, int disp, int r) {
+    rex(b, wide, r, 0, base); byte(b, 0x89); modrm(b, 2, r, base);
+    imm32(b, (uint32_t)disp);
+}
+
+/* r = r + k (add) or r - k (sub) for a round key k. A 64-bit key
+ * that is not a sign-extended imm32 goes through tmp via movabs.  */
+static void key_op(buf *b, int wide, int op, int r, uint64_t k, int tmp) {
+    if (!wide || (uint64_t)(int64_t)(int32_t)k == k) {
+        rex(b, wide, 0, 0, r); byte(b, 0x81);
+        modrm(b, 3, op == ADD ? 0 : 5, r); imm32(b, (uint32_t)k);
+    } else {
+        int i;
+        rex(b, 1, 0, 0, tmp); byte(b, 0xb8 + (tmp&7));
+        for (i=0; i<8; i++) byte(b, (int)(k >> 8*i) & 0xff);
+        rr(b, 1, op, r, tmp);
+    }
+}
+
+static void push(buf *b, int r) { rex(b, 0, 0, 0, r); byte(b, 0x50+(r&7)); }
+static void pop(buf *b, int r)  { rex(b, 0, 0, 0, r); byte(b, 0x58+(r&7)); }
+
+/* add ptr, imm32 (64-bit)                                         */
+static void add_ptr(buf *b, int r, int k) {
+    rex(b, 1, 0, 0, r); byte(b, 0x81); modrm(b, 3, 0, r); imm32(b, (uint32_t)k);
+}
+
+/* cmp/sub qword [rsp], imm8                                       */
+static void stack_op(buf *b, int ext, int k) {
+    byte(b, 0x48); byte(b, 0x83); modrm(b, 0, ext, 4); byte(b, 0x24);
+    byte(b, k);
+}
+#define CMP_EXT 7
+#define SUB_EXT 5
+
+/* Jumps with rel32 operands. Return the offset to patch later.    */
+static size_t jcc(buf *b, int cc) {
+    byte(b, 0x0f); byte(b, 0x80 + cc); imm32(b, 0);
+    return b->n - 4;
+}
+static size_t jmp(buf *b) { byte(b, 0xe9); imm32(b, 0); return b->n - 4; }
+static void patch(buf *b, size_t at, size_t target) {
+    uint32_t rel = (uint32_t)(target - (at + 4));
+    if (!b->fail) memcpy(b->p + at, &rel, 4);
+}
+#define CC_B 2
+#define CC_E 4
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * R C 6   A N D   R C 5   C O D E   G E N E R A T I O N
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Registers free for block words and temporaries                  */
+static const int pool[12] = { RAX, RBX, RDX, RBP, R8, R9,
+                              R10, R11, R12, R13, R14, R15 };
+
+typedef struct {
+    int wide, lgw, nb, r, decrypt;
+    const uint64_t *S;
+} params;
+
+/* One pass over L interleaved RC6 blocks. Each lane keeps A,B,C,D
+ * in v[k][0..3] and temps t,u; the A..D roles rotate by renaming. */
+static void rc6_pass(buf *b, const params *p, int L) {
+    int v[2][4], t[2], u[2], k, i, j, x, W = p->wide;
+    const uint64_t *S = p->S;
+    for (k=0; k<L; k++) {
+        for (j=0; j<4; j++) v[k][j] = pool[6*k+j];
+        t[k] = pool[6*k+4]; u[k] = pool[6*k+5];
+        for (j=0; j<4; j++) load(b, W, v[k][j], RDI, k*4*p->nb + j*p->nb);
+    }
+#define A v[k][0]
+#define B v[k][1]
+#define C v[k][2]
+#define D v[k][3]
+#define LANES for (k=0; k<L; k++)
+    if (!p->decrypt) {
+        LANES { key_op(b, W, ADD, B, S[0], t[k]);
+                key_op(b, W, ADD, D, S[1], u[k]); }
+        for (i=1; i<=p->r; i++) {
+            LANES { lea21(b, W, t[k], B); lea21(b, W, u[k], D); }
+            LANES { imul(b, W, t[k], B); imul(b, W, u[k], D); }
+            LANES { rot_imm(b, W, 0, t[k], p->lgw);
+                    rot_imm(b, W, 0, u[k], p->lgw); }
+            LANES { rr(b, W, XOR, A, t[k]); rr(b, W, XOR, C, u[k]); }
+            LANES { rr(b, 0, MOV, RCX, u[k]); rot_cl(b, W, 0, A);
+                    rr(b, 0, MOV, RCX, t[k]); rot_cl(b, W, 0, C); }
+            LANES { key_op(b, W, ADD, A, S[2*i], t[k]);
+                    key_op(b, W, ADD, C, S[2*i+1], u[k]); }
+            LANES { x = A; A = B; B = C; C = D; D = x; }
+        }
+        LANES { key_op(b, W, ADD, A, S[2*p->r+2], t[k]);
+                key_op(b, W, ADD, C, S[2*p->r+3], u[k]); }
+    } else {
+        LANES { key_op(b, W, SUB, C, S[2*p->r+3], t[k]);
+                key_op(b, W, SUB, A, S[2*p->r+2], u[k]); }
+        for (i=p->r; i>=1; i--) {
+            LANES { x = D; D = C; C = B; B = A; A = x; }
+            LANES { key_op(b, W, SUB, C, S[2*i+1], t[k]);
+                    key_op(b, W, SUB, A, S[2*i], u[k]); }
+            LANES { lea21(b, W, t[k], B); lea21(b, W, u[k], D); }
+            LANES { imul(b, W, t[k], B); imul(b, W, u[k], D); }
+            LANES { rot_imm(b, W, 0, t[k], p->lgw);
+                    rot_imm(b, W, 0, u[k], p->lgw); }
+            LANES { rr(b, 0, MOV, RCX, t[k]); rot_cl(b, W, 1, C);
+                    rr(b, 0, MOV, RCX, u[k]); rot_cl(b, W, 1, A); }
+            LANES { rr(b, W, XOR, C, u[k]); rr(b, W, XOR, A, t[k]); }
+        }
+        LANES { key_op(b, W, SUB, D, S[1], t[k]);
+                key_op(b, W, SUB, B, S[0], u[k]); }
+    }
+    LANES for (j=0; j<4; j++) store(b, W, RSI, k*4*p->nb + j*p->nb, v[k][j]);
+#undef A
+#undef B
+#undef C
+#undef D
+}
+
+/* One pass over L interleaved RC5 blocks: A, B and a temp per lane */
+static void rc5_pass(buf *b, const params *p, int L) {
+    int A[4], B[4], T[4], k, i, W = p->wide;
+    const uint64_t *S = p->S;
+    LANES {
+        A[k] = pool[3*k]; B[k] = pool[3*k+1]; T[k] = pool[3*k+2];
+        load(b, W, A[k], RDI, k*2*p->nb);
+        load(b, W, B[k], RDI, k*2*p->nb + p->nb);
+    }
+    if (!p->decrypt) {
+        LANES { key_op(b, W, ADD, A[k], S[0], T[k]);
+                key_op(b, W, ADD, B[k], S[1], T[k]); }
+        for (i=1; i<=p->r; i++) {
+            LANES { rr(b, W, XOR, A[k], B[k]); rr(b, 0, MOV, RCX, B[k]);
+                    rot_cl(b, W, 0, A[k]);
+                    key_op(b, W, ADD, A[k], S[2*i], T[k]); }
+            LANES { rr(b, W, XOR, B[k], A[k]); rr(b, 0, MOV, RCX, A[k]);
+                    rot_cl(b, W, 0, B[k]);
+                    key_op(b, W, ADD, B[k], S[2*i+1], T[k]); }
+        }
+    } else {
+        for (i=p->r; i>=1; i--) {
+            LANES { key_op(b, W, SUB, B[k], S[2*i+1], T[k]);
+                    rr(b, 0, MOV, RCX, A[k]); rot_cl(b, W, 1, B[k]);
+                    rr(b, W, XOR, B[k], A[k]); }
+            LANES { key_op(b, W, SUB, A[k], S[2*i], T[k]);
+                    rr(b, 0, MOV, RCX, B[k]); rot_cl(b, W, 1, A[k]);
+                    rr(b, W, XOR, A[k], B[k]); }
+        }
+        LANES { key_op(b, W, SUB, B[k], S[1], T[k]);
+                key_op(b, W, SUB, A[k], S[0], T[k]); }
+    }
+    LANES { store(b, W, RSI, k*2*p->nb, A[k]);
+            store(b, W, RSI, k*2*p->nb + p->nb, B[k]); }
+#undef LANES
+}
+
+/* Whole function: an L-lane loop, then a one-lane loop for the rest */
+static void gen(buf *b, const params *p, int L, int rc6) {
+    static const int saved[6] = { RBX, RBP, R12, R13, R14, R15 };
+    int i, bpb = (rc6 ? 4 : 2) * p->nb;
+    size_t top, exit1, exit2, back, tail;
+    for (i=0; i<6; i++) push(b, saved[i]);
+    push(b, RDX);                               /* [rsp] = nblocks  */
+    top = b->n;
+    stack_op(b, CMP_EXT, L);
+    exit1 = jcc(b, CC_B);
+    if (rc6) rc6_pass(b, p, L); else rc5_pass(b, p, L);
+    add_ptr(b, RDI, L*bpb); add_ptr(b, RSI, L*bpb);
+    stack_op(b, SUB_EXT, L);
+    patch(b, jmp(b), top);
+    tail = b->n;
+    patch(b, exit1, tail);
+    if (L > 1) {
+        stack_op(b, CMP_EXT, 1);
+        exit2 = jcc(b, CC_B);
+        if (rc6) rc6_pass(b, p, 1); else rc5_pass(b, p, 1);
+        add_ptr(b, RDI, bpb); add_ptr(b, RSI, bpb);
+        stack_op(b, SUB_EXT, 1);
+        back = jmp(b);
+        patch(b, back, tail);
+        patch(b, exit2, b->n);
+    }
+    pop(b, RDX);
+    for (i=5; i>=0; i--) pop(b, saved[i]);
+    byte(b, 0xc3);                              /* ret              */
+}
+
+static jit_kernel *build(int rc6, int w, int r, int b, const void *key,
+                         int decrypt, int lanes) {
+    params p;
+    buf code = { NULL, 0, 0, 0 };
+    jit_kernel *k = NULL;
+    uint64_t *S;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE), rksz;
+    void *m;
+    if ((w != 32 && w != 64) || lanes < 1 || lanes > (rc6 ? 2 : 4))
+        return NULL;
+    rksz = rc6 ? RC6W_RKEY_BYTES(w, r) : RC5W_RKEY_BYTES(w, r);
+    if ((S = (uint64_t *)malloc(rksz)) == NULL)
+        return NULL;
+    if ((rc6 ? rc6w_setup : rc5w_setup)(S, w, r, b, (void *)key) == 0) {
+        p.wide = (w == 64); p.lgw = (w == 64 ? 6 : 5); p.nb = w/8;
+        p.r = r; p.decrypt = decrypt; p.S = S;
+        gen(&code, &p, lanes, rc6);
+    } else {
+        code.fail = 1;
+    }
+    memset(S, 0, rksz);
+    free(S);
+    if (!code.fail && (k = (jit_kernel *)malloc(sizeof(*k))) != NULL) {
+        /* W^X: fill while writable, then flip to read+execute      */
+        k->size = (code.n + page - 1) / page * page;
+        m = mmap(NULL, k->size, PROT_READ|PROT_WRITE,
+                 MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED) {
+            free(k); k = NULL;
+        } else {
+            memcpy(m, code.p, code.n);
+            if (mprotect(m, k->size, PROT_READ|PROT_EXEC)) {
+                munmap(m, k->size); free(k); k = NULL;
+            } else {
+                k->code = m;
+            }
+        }
+    }
+    if (code.p) { memset(code.p, 0, code.n); free(code.p); }
+    return k;
+}
+
+jit_kernel *jit_rc6(int w, int r, int b, const void *key,
+                    int decrypt, int lanes) {
+    return build(1, w, r, b, key, decrypt, lanes);
+}
+
+jit_kernel *jit_rc5(int w, int r, int b, const void *key,
+                    int decrypt, int lanes) {
+    return build(0, w, r, b, key, decrypt, lanes);
+}
+
+jit_fn jit_entry(const jit_kernel *k) {
+    union { void *p; jit_fn f; } u;
+    u.p = k->code;
+    return u.f;
+}
+
+/* The code embeds the key, so wipe it before unmapping            */
+void jit_free(jit_kernel *k) {
+    if (k) {
+        if (mprotect(k->code, k->size, PROT_READ|PROT_WRITE) == 0)
+            memset(k->code, 0, k->size);
+        munmap(k->code, k->size);
+        free(k);
+    }
+}
+
+#else   /* No code generation on this platform                     */
+
+jit_kernel *jit_rc6(int w, int r, int b, const void *key,
+                    int decrypt, int lanes) {
+    (void)w; (void)r; (void)b; (void)key; (void)decrypt; (void)lanes;
+    return NULL;
+}
+jit_kernel *jit_rc5(int w, int r, int b, const void *key,
+                    int decrypt, int lanes) {
+    (void)w; (void)r; (void)b; (void)key; (void)decrypt; (void)lanes;
+    return NULL;
+}
+jit_fn jit_entry(const jit_kernel *k) { (void)k; return NULL; }
+void jit_free(jit_kernel *k) { (void)k; }
+
+#endif
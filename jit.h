@@ -0,0 +1,39 @@
+/*
+// Run-time generated RC6/RC5 kernels for x86-64 with round keys as
+// immediate operands.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* For a long-lived key, jit_rc6/jit_rc5 expand the key and emit a
+ * function with every round unrolled and every round key embedded
+ * in the instruction stream, so the kernel makes no round-key loads
+ * and has no round loop. lanes (1..2 for RC6, 1..4 for RC5) blocks
+ * are enciphered interleaved per pass, with a one-lane loop for any
+ * remainder. Code is written to a private mapping which is made
+ * read+execute only once complete, and is wiped by jit_free.
+ *
+ * Only w=32 and w=64 are generated, with any r in 0..255; the key,
+ * block layout and results are those of rc6.c with WORD_SZ==w. On
+ * other platforms or parameters the constructors return NULL and the
+ * caller should use the portable functions instead.
+ */
+#ifndef JIT_H
+#define JIT_H
+
+#include <stddef.h>
+
+typedef struct jit_kernel jit_kernel;
+
+/* Encipher nblocks contiguous blocks from in to out (may be equal) */
+typedef void (*jit_fn)(const void *in, void *out, size_t nblocks);
+
+jit_kernel *jit_rc6(int w, int r, int b, const void *key,
+                    int decrypt, int lanes);
+jit_kernel *jit_rc5(int w, int r, int b, const void *key,
+                    int decrypt, int lanes);
+jit_fn jit_entry(const jit_kernel *k);
+void jit_free(jit_kernel *k);
+
+#endif
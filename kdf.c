@@ -0,0 +1,191 @@
+/*
+// Hierarchical key derivation with wide-block RC6 as the PRF.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - rc6_wide.c for the PRF and arena.c for schedule memory.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "rc6_wide.h"
+#include "arena.h"
+#include "kdf.h"
+#include "probes.h"
+
+#define WAYS 4              /* Slots per cache set                   */
+
+struct slot {
+    uint64_t path[KDF_MAX_DEPTH];   /* Node this schedule belongs to */
+    uint64_t used;                  /* LRU stamp, 0 while empty      */
+    int depth;
+    void *rkey;
+};
+
+struct kdf {
+    int w, r, keylen, bpb;
+    size_t nsets;
+    uint64_t clock, hits, setups;
+    struct slot *slot;      /* nsets*WAYS, set s at slot[s*WAYS]      */
+    void *root;             /* Schedule of the master key            */
+    arena *mem;             /* Holds all of the above                */
+};
+
+static size_t round_up(size_t x, size_t m) { return (x+m-1)/m*m; }
+
+/* Clear keys through volatile so the stores are not elided        */
+static void wipe(void *p, size_t n) {
+    volatile unsigned char *v = (volatile unsigned char *)p;
+    while (n--) *v++ = 0;
+}
+
+/* splitmix64 finalizer                                            */
+static uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+}
+
+static struct slot *set_of(const kdf *k, const uint64_t *path, int d) {
+    uint64_t h = (uint64_t)d * UINT64_C(0x9e3779b97f4a7c15);
+    int i;
+    for (i=0; i<d; i++) h = mix(h + path[i]);
+    return k->slot + (size_t)(h % k->nsets) * WAYS;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * S C H E D U L E   C A C H E
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Cached schedule of the node at path[0..d-1], or NULL            */
+static void *lookup(kdf *k, const uint64_t *path, int d) {
+    struct slot *s = set_of(k, path, d);
+    int i;
+    for (i=0; i<WAYS; i++) {
+        if (s[i].used && s[i].depth == d &&
+            memcmp(s[i].path, path, d*sizeof(uint64_t)) == 0) {
+            s[i].used = ++k->clock;
+            k->hits++;
+            PROBE1(cache_hit, k->w);
+            return s[i].rkey;
+        }
+    }
+    PROBE1(cache_miss, k->w);
+    return NULL;
+}
+
+/* Expand key for the node at path[0..d-1] into the least recently
+ * used slot of its set                                            */
+static void *insert(kdf *k, const uint64_t *path, int d,
+                    unsigned char *key) {
+    struct slot *s = set_of(k, path, d), *v = s;
+    int i;
+    for (i=1; i<WAYS; i++)
+        if (s[i].used < v->used) v = s+i;
+    memset(v->path, 0, sizeof(v->path));
+    memcpy(v->path, path, d*sizeof(uint64_t));
+    v->depth = d;
+    v->used = ++k->clock;
+    rc6w_setup(v->rkey, k->w, k->r, k->keylen, key);
+    k->setups++;
+    return v->rkey;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * D E R I V A T I O N
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Key of child i, at depth d, of the node whose schedule is rkey   */
+static void child(const kdf *k, void *rkey, uint64_t i, int d,
+                  unsigned char *key) {
+    unsigned char blk[256];
+    int j;
+    memset(blk, 0, k->bpb);
+    for (j=0; j<8; j++) blk[j] = (unsigned char)(i >> 8*j);
+    blk[8] = (unsigned char)d;
+    rc6w_encrypt(rkey, k->w, k->r, blk, blk);
+    memcpy(key, blk, k->keylen);
+    wipe(blk, k->bpb);
+}
+
+/* Schedule of the node at path[0..d-1], built down from the deepest
+ * cached ancestor. Nodes expanded on the way are cached too.      */
+static void *node(kdf *k, const uint64_t *path, int d) {
+    unsigned char key[256];
+    void *rkey = NULL;
+    int i;
+    for (i=d; i>0 && (rkey = lookup(k, path, i)) == NULL; i--) ;
+    if (i == 0) rkey = k->root;
+    for ( ; i<d; i++) {
+        child(k, rkey, path[i], i+1, key);
+        rkey = insert(k, path, i+1, key);
+    }
+    wipe(key, sizeof(key));
+    return rkey;
+}
+
+kdf *kdf_create(int r, const void *master, int mlen, int keylen,
+                size_t slots, int flags) {
+    kdf *k;
+    arena *mem;
+    int bpb, w;
+    size_t i, nslots, rkb, sz;
+    if (r<0 || r>255 || mlen<0 || mlen>255 || keylen<1 || keylen>255)
+        return NULL;
+    bpb = (int)round_up((size_t)keylen, 4);
+    if (bpb < 16) bpb = 16;             /* Room for index and depth */
+    w = 2*bpb;
+    nslots = round_up(slots ? slots : 1, WAYS);
+    rkb = round_up(RC6W_RKEY_BYTES(w, r), ARENA_ALIGN);
+    if (nslots > (SIZE_MAX/2) / (rkb + sizeof(struct slot)))
+        return NULL;
+    sz = round_up(sizeof(kdf), ARENA_ALIGN) +
+         round_up(nslots*sizeof(struct slot), ARENA_ALIGN) +
+         (nslots+1)*rkb;
+    if ((mem = arena_create(sz, flags)) == NULL)
+        return NULL;
+    k = (kdf *)arena_alloc(mem, sizeof(kdf));
+    k->w = w; k->r = r; k->keylen = keylen; k->bpb = bpb;
+    k->nsets = nslots / WAYS;
+    k->mem = mem;
+    k->slot = (struct slot *)arena_alloc(mem, nslots*sizeof(struct slot));
+    k->root = arena_alloc(mem, rkb);
+    for (i=0; i<nslots; i++)
+        k->slot[i].rkey = arena_alloc(mem, rkb);
+    rc6w_setup(k->root, w, r, mlen, (void *)master);
+    k->setups = 1;
+    return k;
+}
+
+void kdf_destroy(kdf *k) {
+    if (k) arena_destroy(k->mem);
+}
+
+int kdf_derive(kdf *k, const uint64_t *path, int depth, void *key) {
+    if (depth < 1 || depth > KDF_MAX_DEPTH)
+        return -1;
+    child(k, node(k, path, depth-1), path[depth-1], depth,
+          (unsigned char *)key);
+    return 0;
+}
+
+int kdf_derive_batch(kdf *k, const uint64_t *path, int depth,
+                     uint64_t first, size_t n, void *keys) {
+    unsigned char *out = (unsigned char *)keys;
+    void *rkey;
+    size_t i;
+    if (depth < 0 || depth >= KDF_MAX_DEPTH)
+        return -1;
+    rkey = node(k, path, depth);
+    for (i=0; i<n; i++, out += k->keylen)
+        child(k, rkey, first+i, depth+1, out);
+    return 0;
+}
+
+void kdf_stats(const kdf *k, uint64_t *hits, uint64_t *setups) {
+    if (hits) *hits = k->hits;
+    if (setups) *setups = k->setups;
+}
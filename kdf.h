@@ -0,0 +1,64 @@
+/*
+// Hierarchical key derivation with wide-block RC6 as the PRF.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Keys form a tree under a master key: the node at path p[0..d-1]
+ * (eg, tenant, object, chunk) has a keylen-byte key, and the key of
+ * its child i is the first keylen bytes of one RC6 block enciphered
+ * under the parent's key. The block is wide enough to hold a whole
+ * key (w = 8*ceil(keylen/4) bits, at least 32), so each level costs
+ * one block call plus, for interior nodes, one rc6w_setup. The block
+ * holds i as 8 little-endian bytes, then the child's depth, then
+ * zeros.
+ *
+ * Expanded schedules of interior nodes are kept in a cache of a fixed
+ * number of slots, evicting the least recently used within a set of
+ * four. kdf_derive starts from the deepest cached ancestor, so
+ * deriving many keys under one parent expands that parent once while
+ * it stays cached, and kdf_derive_batch derives a run of siblings
+ * from a single lookup. The root schedule is never evicted.
+ *
+ * The cache is updated on every call, so a kdf must not be used from
+ * several threads at once.
+ */
+#ifndef KDF_H
+#define KDF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define KDF_MAX_DEPTH 8     /* Longest path, in components           */
+
+typedef struct kdf kdf;
+
+/* master is mlen bytes (0..255), keylen is 1..255 and r is 0..255.
+ * slots is the number of cached interior schedules, rounded up to a
+ * multiple of 4. flags are ARENA_ flags from arena.h for the memory
+ * holding the schedules, eg ARENA_LOCK. Returns NULL on bad
+ * parameters or if memory cannot be had.
+ */
+kdf *kdf_create(int r, const void *master, int mlen, int keylen,
+                size_t slots, int flags);
+
+/* Wipe all keys and free                                          */
+void kdf_destroy(kdf *k);
+
+/* Write the keylen-byte key of the node at path[0..depth-1] to key.
+ * Returns 0, or -1 unless 1 <= depth <= KDF_MAX_DEPTH.
+ */
+int kdf_derive(kdf *k, const uint64_t *path, int depth, void *key);
+
+/* Keys of children first..first+n-1 of the node at path[0..depth-1],
+ * n*keylen bytes to keys. depth 0 is the master, whose children are
+ * the depth-1 keys. Returns 0, or -1 unless 0 <= depth < KDF_MAX_DEPTH.
+ */
+int kdf_derive_batch(kdf *k, const uint64_t *path, int depth,
+                     uint64_t first, size_t n, void *keys);
+
+/* Cache lookups that found a schedule and rc6w_setup calls made    */
+void kdf_stats(const kdf *k, uint64_t *hits, uint64_t *setups);
+
+#endif
@@ -0,0 +1,271 @@
+/*
+// Modes of operation over the RC6/RC5 interface in rc6.h.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+#include <string.h>
+#include "rc6.h"
+#include "modes.h"
+#include "probes.h"
+
+#define BATCH 8         /* Blocks per encn call, at least            */
+#define BATCH_BYTES (32*BLK_MAX)    /* Room for RC6V_LANES at w=1024 */
+
+void blkcipher_rc6(blkcipher *bc, void *rkey, int w, int r) {
+    bc->enc = rc6_encrypt; bc->dec = rc6_decrypt;
+    bc->encn = bc->decn = NULL;
+    bc->rkey = rkey; bc->w = w; bc->r = r; bc->bpb = w/2;
+    bc->lanes = 0;
+}
+
+void blkcipher_rc5(blkcipher *bc, void *rkey, int w, int r) {
+    bc->enc = rc5_encrypt; bc->dec = rc5_decrypt;
+    bc->encn = bc->decn = NULL;
+    bc->rkey = rkey; bc->w = w; bc->r = r; bc->bpb = w/4;
+    bc->lanes = 0;
+}
+
+/* Add one to big-endian integer c[0..n-1] (mod 2^8n)              */
+static void incr(unsigned char c[], int n) {
+    for ( ; n>0 && ++c[n-1]==0; n--) ;
+}
+
+/* d[0..n-1] = a[0..n-1] xor b[0..n-1]                             */
+static void eor(unsigned char d[], const unsigned char a[],
+                const unsigned char b[], size_t n) {
+    size_t i;
+    for (i=0; i<n; i++) d[i] = a[i] ^ b[i];
+}
+
+/* Keystream buffers are passed to blk_fn, so keep them aligned for
+ * implementations that read whole words (see rc6.c).              */
+typedef union {
+    unsigned char b[BLK_MAX]; unsigned long long a; long double d;
+} blkbuf;
+typedef union {
+    unsigned char b[BATCH_BYTES]; unsigned long long a; long double d;
+} batchbuf;
+typedef union {
+    unsigned char b[BLK_MAX + BATCH_BYTES]; unsigned long long a;
+    long double d;
+} histbuf;
+
+/* Blocks per encn call: whole batches of the kernel's lanes, at
+ * least BATCH, as many as fit BATCH_BYTES                         */
+static size_t batch(const blkcipher *bc) {
+    size_t l = (size_t)bc->lanes, n = (size_t)bc->bpb;
+    size_t k = (l ? (BATCH+l-1)/l*l : BATCH);
+    return (k*n > BATCH_BYTES ? BATCH_BYTES/n : k);
+}
+
+/* Encrypt n independent blocks, through encn when there is one    */
+static void encn(const blkcipher *bc, unsigned char *in,
+                 unsigned char *out, size_t n) {
+    size_t i, bpb = (size_t)bc->bpb;
+    if (bc->encn)
+        bc->encn(bc->rkey, bc->w, bc->r, in, out, n);
+    else
+        for (i=0; i<n; i++)
+            bc->enc(bc->rkey, bc->w, bc->r, in+i*bpb, out+i*bpb);
+}
+
+/* Decrypt n independent blocks, through decn when there is one    */
+static void decn(const blkcipher *bc, unsigned char *in,
+                 unsigned char *out, size_t n) {
+    size_t i, bpb = (size_t)bc->bpb;
+    if (bc->decn)
+        bc->decn(bc->rkey, bc->w, bc->r, in, out, n);
+    else
+        for (i=0; i<n; i++)
+            bc->dec(bc->rkey, bc->w, bc->r, in+i*bpb, out+i*bpb);
+}
+
+/* ECB over a single-block fn copies through an aligned buffer,
+ * since the caller's blocks may sit at any offset                 */
+static void ecb(const blkcipher *bc, blk_fn fn, blkn_fn fnn,
+                const void *in, void *out, size_t len) {
+    const unsigned char *i = (const unsigned char *)in;
+    unsigned char *o = (unsigned char *)out;
+    blkbuf x;
+    size_t n = (size_t)bc->bpb;
+    if (fnn) {
+        fnn(bc->rkey, bc->w, bc->r, (void *)i, o, len/n);
+        return;
+    }
+    for ( ; len >= n; len-=n, i+=n, o+=n) {
+        memcpy(x.b, i, n);
+        fn(bc->rkey, bc->w, bc->r, x.b, x.b);
+        memcpy(o, x.b, n);
+    }
+}
+
+void ecb_encrypt(const blkcipher *bc, const void *in, void *out,
+                 size_t len) {
+    PROBE4(bulk_entry, "ecb_encrypt", len, bc->w, bc->r);
+    ecb(bc, bc->enc, bc->encn, in, out, len);
+    PROBE4(bulk_exit, "ecb_encrypt", len, bc->w, bc->r);
+}
+
+void ecb_decrypt(const blkcipher *bc, const void *in, void *out,
+                 size_t len) {
+    PROBE4(bulk_entry, "ecb_decrypt", len, bc->w, bc->r);
+    ecb(bc, bc->dec, bc->decn, in, out, len);
+    PROBE4(bulk_exit, "ecb_decrypt", len, bc->w, bc->r);
+}
+
+void ctr_crypt(const blkcipher *bc, void *ctr,
+               const void *in, void *out, size_t len) {
+    const unsigned char *i = (const unsigned char *)in;
+    unsigned char *o = (unsigned char *)out;
+    batchbuf c, ks;
+    size_t j, k, m, n = (size_t)bc->bpb, kmax = batch(bc);
+    const size_t len0 = len;
+    PROBE4(bulk_entry, "ctr_crypt", len, bc->w, bc->r);
+    memcpy(c.b, ctr, n);
+    while (len > 0) {
+        k = (len+n-1)/n;
+        if (k > kmax) k = kmax;
+        for (j=1; j<k; j++) {
+            memcpy(c.b+j*n, c.b+(j-1)*n, n);
+            incr(c.b+j*n, (int)n);
+        }
+        encn(bc, c.b, ks.b, k);
+        m = (len < k*n ? len : k*n);
+        eor(o, i, ks.b, m);
+        i += m; o += m; len -= m;
+        memcpy(c.b, c.b+(k-1)*n, n);
+        incr(c.b, (int)n);
+    }
+    memcpy(ctr, c.b, n);
+    PROBE4(bulk_exit, "ctr_crypt", len0, bc->w, bc->r);
+}
+
+void ofb_crypt(const blkcipher *bc, void *iv,
+               const void *in, void *out, size_t len) {
+    const unsigned char *i = (const unsigned char *)in;
+    unsigned char *o = (unsigned char *)out;
+    blkbuf x;
+    size_t n = (size_t)bc->bpb;
+    const size_t len0 = len;
+    PROBE4(bulk_entry, "ofb_crypt", len, bc->w, bc->r);
+    memcpy(x.b, iv, n);
+    for ( ; len > 0; i+=n, o+=n) {
+        bc->enc(bc->rkey, bc->w, bc->r, x.b, x.b);
+        if (len < n) { eor(o, i, x.b, len); break; }
+        eor(o, i, x.b, n);
+        len -= n;
+    }
+    memcpy(iv, x.b, n);
+    PROBE4(bulk_exit, "ofb_crypt", len0, bc->w, bc->r);
+}
+
+/* CFB shift register update: drop s leading bytes, append c[0..s-1] */
+static void cfb_shift(unsigned char reg[], size_t n,
+                      const unsigned char c[], size_t s) {
+    memmove(reg, reg+s, n-s);
+    memcpy(reg+n-s, c, s);
+}
+
+int cfb_encrypt(const blkcipher *bc, int seg, void *iv,
+                const void *in, void *out, size_t len) {
+    const unsigned char *i = (const unsigned char *)in;
+    unsigned char *o = (unsigned char *)out;
+    blkbuf reg, x;
+    size_t n = (size_t)bc->bpb, s = (size_t)seg;
+    const size_t len0 = len;
+    if (seg < 1 || seg > bc->bpb)
+        return -1;
+    PROBE4(bulk_entry, "cfb_encrypt", len, bc->w, bc->r);
+    memcpy(reg.b, iv, n);
+    for ( ; len > 0; i+=s, o+=s) {
+        bc->enc(bc->rkey, bc->w, bc->r, reg.b, x.b);
+        if (len < s) { eor(o, i, x.b, len); break; }
+        eor(o, i, x.b, s);
+        cfb_shift(reg.b, n, o, s);
+        len -= s;
+    }
+    memcpy(iv, reg.b, n);
+    PROBE4(bulk_exit, "cfb_encrypt", len0, bc->w, bc->r);
+    return 0;
+}
+
+/* Every cipher input is a window of IV||ciphertext, known up front,
+ * so a batch of segments is deciphered per encn call. hist holds the
+ * previous n ciphertext bytes followed by this batch's ciphertext,
+ * copied before out (which may alias in) is written.              */
+int cfb_decrypt(const blkcipher *bc, int seg, void *iv,
+                const void *in, void *out, size_t len) {
+    const unsigned char *i = (const unsigned char *)in;
+    unsigned char *o = (unsigned char *)out;
+    batchbuf win, ks;
+    unsigned char hist[BLK_MAX + BATCH_BYTES];
+    size_t j, k, m, n = (size_t)bc->bpb, s = (size_t)seg, kmax = batch(bc);
+    const size_t len0 = len;
+    if (seg < 1 || seg > bc->bpb)
+        return -1;
+    PROBE4(bulk_entry, "cfb_decrypt", len, bc->w, bc->r);
+    memcpy(hist, iv, n);
+    while (len > 0) {
+        k = (len+s-1)/s;
+        if (k > kmax) k = kmax;
+        m = (len < k*s ? len : k*s);
+        memcpy(hist+n, i, m);
+        for (j=0; j<k; j++) memcpy(win.b+j*n, hist+j*s, n);
+        encn(bc, win.b, ks.b, k);
+        for (j=0; j<k; j++)
+            eor(o+j*s, hist+n+j*s, ks.b+j*n, (j+1)*s <= m ? s : m-j*s);
+        i += m; o += m; len -= m;
+        /* Shift in whole segments only, as cfb_encrypt does        */
+        memmove(hist, hist + m/s*s, n);
+    }
+    memcpy(iv, hist, n);
+    PROBE4(bulk_exit, "cfb_decrypt", len0, bc->w, bc->r);
+    return 0;
+}
+
+void cbc_encrypt(const blkcipher *bc, void *iv,
+                 const void *in, void *out, size_t len) {
+    const unsigned char *i = (const unsigned char *)in;
+    unsigned char *o = (unsigned char *)out;
+    blkbuf x;
+    size_t n = (size_t)bc->bpb;
+    const size_t len0 = len;
+    PROBE4(bulk_entry, "cbc_encrypt", len, bc->w, bc->r);
+    memcpy(x.b, iv, n);
+    for ( ; len >= n; len-=n, i+=n, o+=n) {
+        eor(x.b, x.b, i, n);
+        bc->enc(bc->rkey, bc->w, bc->r, x.b, x.b);
+        memcpy(o, x.b, n);
+    }
+    memcpy(iv, x.b, n);
+    PROBE4(bulk_exit, "cbc_encrypt", len0, bc->w, bc->r);
+}
+
+/* Every block is deciphered on its own and then xored with the
+ * ciphertext before it, so a batch goes to decn per call. hist holds
+ * the previous ciphertext block followed by this batch's, copied
+ * before out (which may alias in) is written, word aligned for
+ * bc->dec.                                                        */
+void cbc_decrypt(const blkcipher *bc, void *iv,
+                 const void *in, void *out, size_t len) {
+    const unsigned char *i = (const unsigned char *)in;
+    unsigned char *o = (unsigned char *)out;
+    batchbuf x;
+    histbuf hist;
+    size_t k, n = (size_t)bc->bpb, kmax = batch(bc);
+    const size_t len0 = len;
+    PROBE4(bulk_entry, "cbc_decrypt", len, bc->w, bc->r);
+    memcpy(hist.b, iv, n);
+    while (len >= n) {
+        k = len/n;
+        if (k > kmax) k = kmax;
+        memcpy(hist.b+n, i, k*n);
+        decn(bc, hist.b+n, x.b, k);
+        eor(o, x.b, hist.b, k*n);
+        i += k*n; o += k*n; len -= k*n;
+        memcpy(hist.b, hist.b+k*n, n);
+    }
+    memcpy(iv, hist.b, n);
+    PROBE4(bulk_exit, "cbc_decrypt", len0, bc->w, bc->r);
+}
@@ -0,0 +1,91 @@
+/*
+// Modes of operation over the RC6/RC5 interface in rc6.h.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* The modes here only call the functions declared in rc6.h, so they
+ * work with whichever implementation is linked (rc6.c, rc6_ref.c)
+ * and with any block size that implementation supports. Counters and
+ * IVs are one block long and are treated as big-endian integers.
+ */
+#ifndef MODES_H
+#define MODES_H
+
+#include <stddef.h>
+
+#define BLK_MAX 512     /* Largest block: RC6 with w=1024            */
+
+/* Same shape as rc6_encrypt/rc6_decrypt in rc6.h                  */
+typedef void (*blk_fn)(void *rkey, int w, int r, void *in, void *out);
+/* Encipher nblocks independent, contiguous blocks; in and out may
+ * be equal and need no particular alignment                       */
+typedef void (*blkn_fn)(void *rkey, int w, int r, void *in, void *out,
+                        size_t nblocks);
+
+typedef struct {
+    blk_fn enc, dec;
+    blkn_fn encn, decn; /* Optional multi-block kernels, else NULL  */
+    void *rkey;         /* Filled by rc6_setup/rc5_setup            */
+    int w, r;
+    int bpb;            /* Bytes per block                          */
+    int lanes;          /* Blocks encn does at once, 0 if unknown   */
+} blkcipher;
+
+void blkcipher_rc6(blkcipher *bc, void *rkey, int w, int r);
+void blkcipher_rc5(blkcipher *bc, void *rkey, int w, int r);
+
+/* ECB mode. len must be a multiple of bpb; in and out may be equal.
+ * Whole runs go to bc->encn/decn when set.
+ */
+void ecb_encrypt(const blkcipher *bc, const void *in, void *out,
+                 size_t len);
+void ecb_decrypt(const blkcipher *bc, const void *in, void *out,
+                 size_t len);
+
+/* CTR mode. Encryption and decryption are the same operation. ctr
+ * is advanced by the number of blocks consumed, so long messages can
+ * be processed in pieces as long as each piece but the last is a
+ * multiple of bpb bytes. in and out may be equal.
+ */
+void ctr_crypt(const blkcipher *bc, void *ctr,
+               const void *in, void *out, size_t len);
+
+/* OFB mode. Encryption and decryption are the same operation. iv
+ * is replaced by the last output block for chaining; each piece but
+ * the last must be a multiple of bpb bytes.
+ */
+void ofb_crypt(const blkcipher *bc, void *iv,
+               const void *in, void *out, size_t len);
+
+/* CFB mode with seg-byte segments, 1 <= seg <= bpb: seg=bpb is full
+ * block CFB, seg=1 is CFB-8 and seg=w/8 is CFB-w. iv is replaced by
+ * the shift register for chaining; each piece but the last must be a
+ * multiple of seg bytes. Decryption feeds several blocks at a time to
+ * bc->encn, since all its cipher inputs are known ciphertext.
+ *
+ * CTR and CFB decryption hand bc->encn a multiple of bc->lanes blocks
+ * per call, within a buffer of 32*BLK_MAX bytes, so a vector kernel
+ * is not padded to fill its lanes.
+ *
+ * Both return 0, or -1 without touching iv or out if seg is out of
+ * range.
+ */
+int cfb_encrypt(const blkcipher *bc, int seg, void *iv,
+                const void *in, void *out, size_t len);
+int cfb_decrypt(const blkcipher *bc, int seg, void *iv,
+                const void *in, void *out, size_t len);
+
+/* CBC mode. len must be a multiple of bpb. iv is replaced by the
+ * last ciphertext block so calls can be chained. in and out may be
+ * equal. Encryption is serial, one bc->enc call per block;
+ * decryption has no serial dependency between blocks and hands
+ * bc->decn batches as CTR does.
+ */
+void cbc_encrypt(const blkcipher *bc, void *iv,
+                 const void *in, void *out, size_t len);
+void cbc_decrypt(const blkcipher *bc, void *iv,
+                 const void *in, void *out, size_t len);
+
+#endif
@@ -0,0 +1,56 @@
+/*
+// USDT (SystemTap SDT) probe points for production tracing.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* With <sys/sdt.h> available (systemtap-sdt-dev / -devel) each probe
+ * compiles to one nop plus an ELF note naming its arguments: no
+ * branch, no call, nothing evaluated beyond what the arguments need
+ * in registers. Attaching bpftrace or perf patches the nop into a
+ * breakpoint at run time, so no rebuild is needed, eg:
+ *
+ *   bpftrace -e 'usdt:./app:rc6:bulk_entry { @t[tid] = nsecs; }
+ *                usdt:./app:rc6:bulk_exit /@t[tid]/ {
+ *                    @us[str(arg0)] = hist((nsecs - @t[tid])/1000);
+ *                    delete(@t[tid]); }'
+ *
+ * Provider rc6; probes and arguments:
+ *
+ *   setup       (cipher, w, r, b, ret)  cipher 6 or 5; ret as returned
+ *   bulk_entry  (what, len, w, r)       what: mode or kernel name
+ *   bulk_exit   (what, len, w, r)       len in bytes
+ *   dispatch    (site, choice, w)       site: a name; choice: its code
+ *   cache_hit   (w)                     a schedule cache had w
+ *   cache_miss  (w)                     it expanded one for w
+ *   rekey       (w, epoch, stalled)     usage.c started an epoch
+ *
+ * Without <sys/sdt.h>, or with -DRC6_NO_PROBES, the macros generate
+ * no code and the arguments are not evaluated.
+ */
+#ifndef PROBES_H
+#define PROBES_H
+
+#if !defined(RC6_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define RC6_HAVE_PROBES 1
+#endif
+#endif
+
+#ifdef RC6_HAVE_PROBES
+#define PROBE1(n, a)             DTRACE_PROBE1(rc6, n, a)
+#define PROBE3(n, a, b, c)       DTRACE_PROBE3(rc6, n, a, b, c)
+#define PROBE4(n, a, b, c, d)    DTRACE_PROBE4(rc6, n, a, b, c, d)
+#define PROBE5(n, a, b, c, d, e) DTRACE_PROBE5(rc6, n, a, b, c, d, e)
+#else
+/* sizeof names the arguments, so locals kept only for a probe do
+ * not warn as unused, without evaluating them                     */
+#define PROBE1(n, a)             ((void)sizeof(a))
+#define PROBE3(n, a, b, c)       (PROBE1(n, a), PROBE1(n, b), PROBE1(n, c))
+#define PROBE4(n, a, b, c, d)    (PROBE3(n, a, b, c), PROBE1(n, d))
+#define PROBE5(n, a, b, c, d, e) (PROBE4(n, a, b, c, d), PROBE1(n, e))
+#endif
+
+#endif
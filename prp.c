@@ -0,0 +1,147 @@
+/*
+// Lazy pseudo-random permutations of [0, n) for sampling and shuffling.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - rc6_wide.c for the RC5-32 key schedule and codebook.c.
+ * - The lane loops are written for auto-vectorization (-O3).
+ */
+
+#include <string.h>
+#include "rc6_wide.h"
+#include "prp.h"
+
+#define ROUNDS 10           /* Feistel rounds, as FF1 uses            */
+#define L PRP_LANES
+
+static uint32_t rotl(uint32_t x, uint32_t d) {
+    return x << (d&31) | x >> (-d&31);
+}
+
+/* y[j] = first word of RC5-32 on (x[j], tw), for j < m              */
+static void f(const prp *p, uint32_t tw, const uint32_t *x,
+              uint32_t *y, size_t m) {
+    uint32_t A[L], B[L];
+    const uint32_t *S = p->S;
+    size_t j;
+    int i;
+    for (j=0; j<m; j++) {
+        A[j] = x[j] + S[0];
+        B[j] = tw + S[1];
+    }
+    for (i=1; i<=p->r; i++) {
+        for (j=0; j<m; j++) {
+            A[j] = rotl(A[j]^B[j], B[j]) + S[2*i];
+            B[j] = rotl(B[j]^A[j], A[j]) + S[2*i+1];
+        }
+    }
+    memcpy(y, A, m*sizeof(uint32_t));
+}
+
+/* Encipher m <= L values of p->bits bits in place                  */
+static void feistel(const prp *p, uint64_t *x, size_t m) {
+    uint32_t h[L], l[L], t[L];
+    uint32_t mh = (uint32_t)(~UINT64_C(0) >> (64 - p->hi));
+    uint32_t ml = (uint32_t)(~UINT64_C(0) >> (64 - p->lo));
+    size_t j;
+    int i;
+    for (j=0; j<m; j++) {
+        h[j] = (uint32_t)(x[j] >> p->lo);
+        l[j] = (uint32_t)x[j] & ml;
+    }
+    for (i=0; i<ROUNDS; i++) {
+        uint32_t tw = (uint32_t)(i | p->bits << 8);
+        if (i & 1) {
+            f(p, tw, h, t, m);
+            for (j=0; j<m; j++) l[j] ^= t[j] & ml;
+        } else {
+            f(p, tw, l, t, m);
+            for (j=0; j<m; j++) h[j] ^= t[j] & mh;
+        }
+    }
+    for (j=0; j<m; j++) x[j] = (uint64_t)h[j] << p->lo | l[j];
+}
+
+/* cb_fn over the 2^bits domain, for the codebook                  */
+static uint32_t feistel1(void *ctx, uint32_t x) {
+    uint64_t y = x;
+    feistel((const prp *)ctx, &y, 1);
+    return (uint32_t)y;
+}
+
+int prp_init(prp *p, uint64_t n, int r, int b, const void *key) {
+    uint64_t rk[2*255+2];
+    int i;
+    memset(p, 0, sizeof(*p));
+    if (n < 1 || r<0 || r>255 || b<0 || b>255)
+        return -1;
+    p->n = n; p->r = r;
+    p->bits = 2;
+    while (p->bits < 64 && (UINT64_C(1) << p->bits) < n) p->bits++;
+    p->lo = p->bits/2;
+    p->hi = p->bits - p->lo;
+    rc5w_setup(rk, 32, r, b, (void *)key);
+    for (i=0; i<2*r+2; i++) p->S[i] = (uint32_t)rk[i];
+    memset(rk, 0, sizeof(rk));
+    if (p->bits <= 16 && cb_build(&p->cb, p->bits, feistel1, p, 1, NULL)) {
+        prp_free(p);
+        return -1;
+    }
+    return 0;
+}
+
+void prp_free(prp *p) {
+    if (p->cb.enc) cb_free(&p->cb);
+    memset(p, 0, sizeof(*p));
+}
+
+uint64_t prp_at(const prp *p, uint64_t i) {
+    prp_at_n(p, &i, &i, 1);
+    return i;
+}
+
+void prp_at_n(const prp *p, const uint64_t *in, uint64_t *out,
+              size_t cnt) {
+    size_t base;
+    if (p->cb.enc) {
+        for (base=0; base<cnt; base++) {
+            uint32_t y = p->cb.enc[in[base]];
+            while (y >= p->n) y = p->cb.enc[y];
+            out[base] = y;
+        }
+        return;
+    }
+    for (base=0; base<cnt; base+=L) {
+        uint64_t x[L];
+        size_t pos[L], j, k, m = (cnt-base < L ? cnt-base : L);
+        for (j=0; j<m; j++) { x[j] = in[base+j]; pos[j] = base+j; }
+        /* Encipher, keep what is in range, walk the rest again    */
+        while (m > 0) {
+            feistel(p, x, m);
+            for (j=0, k=0; j<m; j++) {
+                if (x[j] < p->n) out[pos[j]] = x[j];
+                else { x[k] = x[j]; pos[k] = pos[j]; k++; }
+            }
+            m = k;
+        }
+    }
+}
+
+void prp_iter_init(prp_iter *it, const prp *p, uint64_t start) {
+    it->p = p;
+    it->next = start;
+}
+
+size_t prp_iter_next(prp_iter *it, uint64_t *out, size_t max) {
+    size_t j, m;
+    if (it->next >= it->p->n)
+        return 0;
+    m = (it->p->n - it->next < max ? (size_t)(it->p->n - it->next) : max);
+    for (j=0; j<m; j++) out[j] = it->next + j;
+    prp_at_n(it->p, out, out, m);
+    it->next += m;
+    return m;
+}
@@ -0,0 +1,65 @@
+/*
+// Lazy pseudo-random permutations of [0, n) for sampling and shuffling.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* pi(i) for any n up to 2^64-1, computed on demand, so a shuffle of
+ * billions of items needs no index array. The cipher works on k-bit
+ * values, where 2^k is the smallest power of two of at least n (k at
+ * least 2). It is an alternating Feistel network on a ceil(k/2)-bit
+ * and a floor(k/2)-bit half; each of its 10 rounds xors one half
+ * with RC5-32/r of the other half, the round number and k. Values
+ * of n or above are enciphered again (cycle walking) until they land
+ * in range, which takes fewer than two passes on average.
+ *
+ * For k <= 16 the whole cipher is tabulated with cb_build, so pi(i)
+ * is one or two loads. Otherwise prp_at_n and the iterator evaluate
+ * PRP_LANES indices per pass, with every Feistel round run across
+ * all of them.
+ */
+#ifndef PRP_H
+#define PRP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "codebook.h"
+
+#define PRP_LANES 64
+
+typedef struct {
+    uint64_t n;
+    int bits, hi, lo;           /* bits = hi + lo, hi = lo or lo+1  */
+    int r;
+    uint32_t S[2*255+2];        /* RC5-32 round keys                */
+    codebook cb;                /* bits <= 16 only, else cb.enc NULL */
+} prp;
+
+/* Permutation of [0, n), n >= 1, keyed by key[0..b-1] with r RC5
+ * rounds per Feistel round; r and b in 0..255. Returns 0, or -1 on
+ * bad parameters or memory failure.
+ */
+int prp_init(prp *p, uint64_t n, int r, int b, const void *key);
+void prp_free(prp *p);
+
+/* pi(i) for i < n                                                 */
+uint64_t prp_at(const prp *p, uint64_t i);
+
+/* out[j] = pi(in[j]) for j < cnt, all in[j] < n. in and out may be
+ * equal.                                                          */
+void prp_at_n(const prp *p, const uint64_t *in, uint64_t *out,
+              size_t cnt);
+
+/* Yields pi(start), pi(start+1), ..., pi(n-1)                     */
+typedef struct {
+    const prp *p;
+    uint64_t next;
+} prp_iter;
+
+void prp_iter_init(prp_iter *it, const prp *p, uint64_t start);
+
+/* Write up to max next values to out; returns how many, 0 at end  */
+size_t prp_iter_next(prp_iter *it, uint64_t *out, size_t max);
+
+#endif
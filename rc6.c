@@ -36,18 +36,38 @@
 */
 
 /* Requirements of this implementation:
- * - At compile-time: WORD_SZ must be set to one of 8/16/32/64/128.
+ * - At compile-time: WORD_SZ must be set to one of 8/16/32/64/128
+ *   (edit the default below or pass eg, -DWORD_SZ=32).
  * - At run-time: w==WORD_SZ, r%4==0, and both b and r in 0..255.
  * - All pointers (except user key) must be okay for WORD read/write.
- * - GCC extensions: __builtin_bswap32, __builtin_bswap64, __int128.
+ * - GCC extensions: __builtin_bswap32, __builtin_bswap64, __int128,
+ *   and a constructor attribute if RC6_F_TABLE is defined.
+ *
+ * Option: with WORD_SZ 8 or 16, -DRC6_F_TABLE replaces f(x) =
+ * rotl(x*(2x+1), lg w) by a lookup in a key-independent table of
+ * 2^WORD_SZ words, filled once when the program is loaded.
+ *
+ * The tweakable rc6t_ functions follow the same rules; the tweak is
+ * two WORDs and must be okay for WORD read as well.
+ *
+ * Dispatch: on x86-64 ELF targets with GCC 6+ or Clang 14+, the
+ * encrypt and decrypt entry points are built for baseline x86-64,
+ * BMI2, AVX2 and AVX-512 with target_clones. The dynamic loader picks
+ * one through a GNU IFUNC resolver when the symbol is bound, so each
+ * call goes straight to the selected kernel with no feature test or
+ * extra indirection. This needs a libc with IFUNC support (glibc,
+ * not musl); -DRC6_NO_IFUNC builds one plain version instead.
  *
  * Note: For faster performance unroll loops (eg, gcc -O3).
  */
  
 #include <stdint.h>
 #include "rc6.h"
+#include "probes.h"
 
+#ifndef WORD_SZ
 #define WORD_SZ 64        /* word size bits, one of 8/16/32/64/128 */
+#endif
 
 /* Definitions for each supported word size. Some GCC-specific.    */
 #if WORD_SZ==8
@@ -84,6 +104,16 @@
     #error -- WORD_SZ must be 8, 16, 32, 64, or 128
 #endif
 
+/* Per-CPU clones of the block functions, chosen at load time      */
+#if defined(__x86_64__) && defined(__ELF__) && !defined(RC6_NO_IFUNC) && \
+    ((defined(__clang__) && __clang_major__ >= 14) || \
+     (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 6))
+#define KERNEL __attribute__((target_clones("default", "bmi2", "avx2", \
+                                            "avx512f")))
+#else
+#define KERNEL
+#endif
+
 static int max(int a, int b) { return (a>b ? a : b); }
 static WORD rotl(WORD x, int d) { return (x<<d)|(x>>(WORD_SZ-d)); }
 static WORD rotr(WORD x, int d) { return (x>>d)|(x<<(WORD_SZ-d)); }
@@ -92,6 +122,21 @@ static WORD bswap_if_be(WORD x) {
     return (little.endian ? x : bswap(x));
 }
 
+/* RC6's quadratic function, computed or looked up                 */
+#if defined(RC6_F_TABLE) && WORD_SZ <= 16
+static WORD ftab[1 << WORD_SZ];
+__attribute__((constructor)) static void ftab_init(void) {
+    unsigned i;
+    for (i=0; i < 1u<<WORD_SZ; i++) {
+        WORD x = (WORD)i;
+        ftab[i] = rotl(x * (2*x+1), LGW);
+    }
+}
+#define F(x) ftab[x]
+#else
+#define F(x) rotl((x) * (2*(x)+1), LGW)
+#endif
+
 static int setup(WORD *S, int S_words,
                      int w, int r, int b, void *key) {
     if ((WORD_SZ!=w)||(b<0)||(b>255)||(r<0)||(r>255)||(r%4!=0)) {
@@ -118,13 +163,17 @@ static int setup(WORD *S, int S_words,
 }
 /* Assumes rkey alignment okay for WORD read/write                 */
 int rc5_setup(void *rkey, int w, int r, int b, void *key) {
-    return setup((WORD *)rkey, 2*r+2, w, r, b, key);
+    int ret = setup((WORD *)rkey, 2*r+2, w, r, b, key);
+    PROBE5(setup, 5, w, r, b, ret);
+    return ret;
 }
 int rc6_setup(void *rkey, int w, int r, int b, void *key) {
-    return setup((WORD *)rkey, 2*r+4, w, r, b, key);
+    int ret = setup((WORD *)rkey, 2*r+4, w, r, b, key);
+    PROBE5(setup, 6, w, r, b, ret);
+    return ret;
 }
 
-void rc5_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
+KERNEL void rc5_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
     int i,j;
     WORD *S=(WORD *)rkey, *p=(WORD *)pt, *c=(WORD *)ct;
     WORD A = bswap_if_be(p[0]) + *(S++);
@@ -139,7 +188,7 @@ void rc5_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
     c[1] = bswap_if_be(B);
 }
 
-void rc5_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
+KERNEL void rc5_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
     int i,j;
     WORD *S=(WORD *)rkey+2*r+1, *p=(WORD *)pt, *c=(WORD *)ct;
     WORD B = bswap_if_be(c[1]);
@@ -154,7 +203,7 @@ void rc5_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
     p[0] = bswap_if_be(A - *S);
 }
 
-void rc6_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
+KERNEL void rc6_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
     int i,j;
     WORD t, u, *S=(WORD *)rkey, *p=(WORD *)pt, *c=(WORD *)ct;
     WORD A = bswap_if_be(p[0]);
@@ -163,8 +212,8 @@ void rc6_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
     WORD D = bswap_if_be(p[3]) + *(S++);
     for (i=0; i<r/4; i++) {
         for (j=0; j<4; j++) {           
-            t = rotl(B * (2*B+1), LGW);
-            u = rotl(D * (2*D+1), LGW);
+            t = F(B);
+            u = F(D);
             A = rotl(A^t, u % WORD_SZ) + *(S++);
             C = rotl(C^u, t % WORD_SZ) + *(S++);
             t=A; A=B; B=C; C=D; D=t;
@@ -176,7 +225,7 @@ void rc6_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
     c[3] = bswap_if_be(D);
 }
 
-void rc6_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
+KERNEL void rc6_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
     int i,j;
     WORD t, u, *S=(WORD *)rkey+2*r+3, *p=(WORD *)pt, *c=(WORD *)ct;
     WORD D = bswap_if_be(c[3]);
@@ -186,8 +235,8 @@ void rc6_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
     for (i=0; i<r/4; i++) {
         for (j=0; j<4; j++) {
             t=D; D=C; C=B; B=A; A=t;
-            u = rotl(D * (2*D+1), LGW);
-            t = rotl(B * (2*B+1), LGW);
+            u = F(D);
+            t = F(B);
             C = rotr(C - *(S--), t % WORD_SZ)^u;
             A = rotr(A - *(S--), u % WORD_SZ)^t;
         }
@@ -197,3 +246,137 @@ void rc6_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
     p[1] = bswap_if_be(B - *S);
     p[0] = bswap_if_be(A);
 }
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * T W E A K A B L E   R C 6
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Adding a tweak word to a round key is the same as adding it to
+ * the word that key lands in, so the schedule is left alone. After
+ * each group of four rounds A's output sits in D and C's in B. x,y,z
+ * hold T[j%3], T[(j+1)%3], T[(j+2)%3] for the current injection j.
+ *
+ * tenc and tdec run L blocks side by side, block k with T0+k, so
+ * the n variants keep TLANES independent multiply-rotate chains in
+ * flight instead of one. L is a constant at every call; the round
+ * loops over lanes are unrolled even at -O2, since left as loops the
+ * lane arrays stay in memory. L=1 is the single-block cipher.
+ */
+#define TLANES 4          /* Blocks interleaved by the n variants  */
+
+static inline __attribute__((always_inline))
+void tenc(WORD *S, int r, int L, WORD T0, WORD T1, WORD *p, WORD *c) {
+    int i,j,k;
+    WORD t, u, A[TLANES], B[TLANES], C[TLANES], D[TLANES];
+    WORD x[TLANES], y[TLANES], z[TLANES];
+    for (k=0; k<L; k++, p+=4) {
+        x[k] = T0+k; y[k] = T1; z[k] = x[k]^T1;
+        A[k] = bswap_if_be(p[0]);
+        B[k] = bswap_if_be(p[1]) + S[0] + x[k];
+        C[k] = bswap_if_be(p[2]);
+        D[k] = bswap_if_be(p[3]) + S[1] + y[k];
+    }
+    S += 2;
+    for (i=1; i<=r/4; i++) {
+        for (j=0; j<4; j++, S+=2) {
+#pragma GCC unroll 4
+            for (k=0; k<L; k++) {
+                t = F(B[k]);
+                u = F(D[k]);
+                A[k] = rotl(A[k]^t, u % WORD_SZ) + S[0];
+                C[k] = rotl(C[k]^u, t % WORD_SZ) + S[1];
+                t=A[k]; A[k]=B[k]; B[k]=C[k]; C[k]=D[k]; D[k]=t;
+            }
+        }
+        for (k=0; k<L; k++) {
+            t=x[k]; x[k]=y[k]; y[k]=z[k]; z[k]=t;
+            if (i < r/4) { D[k] += x[k]; B[k] += y[k] + i; }
+        }
+    }
+    for (k=0; k<L; k++, c+=4) {
+        c[0] = bswap_if_be(A[k] + S[0] + x[k]);
+        c[1] = bswap_if_be(B[k]);
+        c[2] = bswap_if_be(C[k] + S[1] + y[k] + r/4);
+        c[3] = bswap_if_be(D[k]);
+    }
+}
+
+static inline __attribute__((always_inline))
+void tdec(WORD *S, int r, int L, WORD T0, WORD T1, WORD *c, WORD *p) {
+    int i,j,k;
+    WORD t, u, A[TLANES], B[TLANES], C[TLANES], D[TLANES];
+    WORD x[TLANES], y[TLANES], z[TLANES], T[3];
+    for (k=0; k<L; k++, c+=4) {
+        T[0] = T0+k; T[1] = T1; T[2] = T[0]^T1;
+        x[k] = T[r/4%3]; y[k] = T[(r/4+1)%3]; z[k] = T[(r/4+2)%3];
+        D[k] = bswap_if_be(c[3]);
+        C[k] = bswap_if_be(c[2]) - S[0] - y[k] - r/4;
+        B[k] = bswap_if_be(c[1]);
+        A[k] = bswap_if_be(c[0]) - S[-1] - x[k];
+    }
+    S -= 2;
+    for (i=r/4; i>=1; i--) {
+        for (k=0; k<L; k++)
+            if (i < r/4) { D[k] -= x[k]; B[k] -= y[k] + i; }
+        for (j=0; j<4; j++, S-=2) {
+#pragma GCC unroll 4
+            for (k=0; k<L; k++) {
+                t=D[k]; D[k]=C[k]; C[k]=B[k]; B[k]=A[k]; A[k]=t;
+                u = F(D[k]);
+                t = F(B[k]);
+                C[k] = rotr(C[k] - S[0], t % WORD_SZ)^u;
+                A[k] = rotr(A[k] - S[-1], u % WORD_SZ)^t;
+            }
+        }
+        for (k=0; k<L; k++) { t=z[k]; z[k]=y[k]; y[k]=x[k]; x[k]=t; }
+    }
+    for (k=0; k<L; k++, p+=4) {
+        p[3] = bswap_if_be(D[k] - S[0] - y[k]);
+        p[2] = bswap_if_be(C[k]);
+        p[1] = bswap_if_be(B[k] - S[-1] - x[k]);
+        p[0] = bswap_if_be(A[k]);
+    }
+}
+
+/* Load tweak words T0,T1                                          */
+static void tload(WORD T[2], void *tweak) {
+    WORD *tw = (WORD *)tweak;
+    T[0] = bswap_if_be(tw[0]);
+    T[1] = bswap_if_be(tw[1]);
+}
+
+KERNEL void rc6t_encrypt(void *rkey, int w, int r, void *tweak,
+                         void *pt, void *ct) {
+    WORD T[2];
+    tload(T, tweak);
+    tenc((WORD *)rkey, r, 1, T[0], T[1], (WORD *)pt, (WORD *)ct);
+}
+
+KERNEL void rc6t_decrypt(void *rkey, int w, int r, void *tweak,
+                         void *ct, void *pt) {
+    WORD T[2];
+    tload(T, tweak);
+    tdec((WORD *)rkey+2*r+3, r, 1, T[0], T[1], (WORD *)ct, (WORD *)pt);
+}
+
+KERNEL void rc6t_encryptn(void *rkey, int w, int r, void *tweak,
+                          void *pt, void *ct, size_t nblocks) {
+    WORD T[2], *p=(WORD *)pt, *c=(WORD *)ct;
+    tload(T, tweak);
+    for ( ; nblocks >= TLANES; nblocks-=TLANES, p+=4*TLANES, c+=4*TLANES,
+                               T[0]+=TLANES)
+        tenc((WORD *)rkey, r, TLANES, T[0], T[1], p, c);
+    for ( ; nblocks > 0; nblocks--, p+=4, c+=4, T[0]++)
+        tenc((WORD *)rkey, r, 1, T[0], T[1], p, c);
+}
+
+KERNEL void rc6t_decryptn(void *rkey, int w, int r, void *tweak,
+                          void *ct, void *pt, size_t nblocks) {
+    WORD T[2], *p=(WORD *)pt, *c=(WORD *)ct;
+    tload(T, tweak);
+    for ( ; nblocks >= TLANES; nblocks-=TLANES, p+=4*TLANES, c+=4*TLANES,
+                               T[0]+=TLANES)
+        tdec((WORD *)rkey+2*r+3, r, TLANES, T[0], T[1], c, p);
+    for ( ; nblocks > 0; nblocks--, p+=4, c+=4, T[0]++)
+        tdec((WORD *)rkey+2*r+3, r, 1, T[0], T[1], c, p);
+}
@@ -41,6 +41,10 @@
  * to avoid errors or improve performance. Consult your
  * implementation's documentation to see if this applies to you.
  */
+#ifndef RC6_H
+#define RC6_H
+
+#include <stddef.h>
  
 /* rc6_setup returns 0 iff the implementation supports the actual
  * parameters supplied and rkey is filled successfully. rkey and
@@ -57,3 +61,31 @@ void rc6_decrypt(void *rkey, int w, int r, void *ct, void *pt);
 int rc5_setup(void *rkey, int w, int r, int b, void *key);
 void rc5_encrypt(void *rkey, int w, int r, void *pt, void *ct);
 void rc5_decrypt(void *rkey, int w, int r, void *ct, void *pt);
+
+/* Experimental tweakable RC6. tweak points to two words T0,T1 (w/4
+ * bytes, stored like block words) and rkey is an unchanged rc6_setup
+ * schedule: the tweak is added into round keys as the block is
+ * enciphered, so a new tweak costs a few additions, not a setup. With
+ * T = (T0, T1, T0^T1), injection j adds T[j%3] to the first key of a
+ * pair and T[(j+1)%3] + j to the second. Injection 0 is the initial
+ * key pair, injection j the pair of round 4j for 0 < 4j < r, and the
+ * last, numbered (r+3)/4, the final key pair. This is not RC6 and has
+ * had no cryptanalysis; use it only where a tweak must be cheap.
+ *
+ * The n variants process nblocks contiguous blocks; block k of the
+ * batch uses T0+k (mod 2^w) and the same T1, so eg, T1 = sector and
+ * T0 = index of the first block covers a sector in one call. rc6.c
+ * enciphers the blocks of a batch four at a time, interleaved, so
+ * their serial multiply-rotate chains overlap. The tweak buffer is
+ * not changed.
+ */
+void rc6t_encrypt(void *rkey, int w, int r, void *tweak,
+                  void *pt, void *ct);
+void rc6t_decrypt(void *rkey, int w, int r, void *tweak,
+                  void *ct, void *pt);
+void rc6t_encryptn(void *rkey, int w, int r, void *tweak,
+                   void *pt, void *ct, size_t nblocks);
+void rc6t_decryptn(void *rkey, int w, int r, void *tweak,
+                   void *ct, void *pt, size_t nblocks);
+
+#endif
@@ -0,0 +1,438 @@
+/*
+// Compile-time and inlinable RC6 & RC5 for C++17/20.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Header-only constexpr versions of setup, encrypt and decrypt for
+ * the power-of-two word sizes of rc6.c: 8, 16, 32, 64 and, where the
+ * compiler has unsigned __int128, 128. Anything computed from
+ * constants is a constant, so test vectors, key-check values and
+ * obfuscated configuration can be folded at compile time:
+ *
+ *   constexpr std::array<unsigned char, 16> key = { ... };
+ *   constexpr auto k = rc6::rc6_setup<32, 20>(key);
+ *   constexpr rc6::rc6_block<32> c = rc6::rc6_encrypt(k, block);
+ *
+ * Block and key bytes, and results, are those of rc6.c and rc6_ref.c,
+ * independently of host byte order. r is any of 0..255 (rc6.c wants
+ * r%4==0; these do not). The same functions work at run time, where
+ * they are portable but not tuned.
+ *
+ * With C++20, Rc6Key<W, R> and Rc5Key<W, R> hold a schedule typed
+ * by its parameters, with block functions on std::span that are
+ * forced inline: a hot single-block call site compiles to the rounds
+ * themselves, with w and r as constants.
+ *
+ * The draft test vectors are checked with static_assert at the end,
+ * so each compiler that includes this file verifies the code; define
+ * RC6_HPP_NO_SELFTEST to skip that.
+ */
+#ifndef RC6_HPP
+#define RC6_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<span>)
+#include <span>
+#include <stdexcept>
+#define RC6_HPP_SPAN 1
+#endif
+#endif
+
+namespace rc6 {
+
+/* Word type and magic constants P = Odd((e-2)2^w), Q = Odd((phi-1)2^w) */
+template <int W> struct word;
+template <> struct word<8> {
+    typedef std::uint8_t type;
+    static constexpr type P = 0xb7, Q = 0x9f;
+};
+template <> struct word<16> {
+    typedef std::uint16_t type;
+    static constexpr type P = 0xb7e1, Q = 0x9e37;
+};
+template <> struct word<32> {
+    typedef std::uint32_t type;
+    static constexpr type P = UINT32_C(0xb7e15163), Q = UINT32_C(0x9e3779b9);
+};
+template <> struct word<64> {
+    typedef std::uint64_t type;
+    static constexpr type P = UINT64_C(0xb7e151628aed2a6b),
+                          Q = UINT64_C(0x9e3779b97f4a7c15);
+};
+#ifdef __SIZEOF_INT128__
+template <> struct word<128> {
+    __extension__ typedef unsigned __int128 type;
+    static constexpr type P = type(UINT64_C(0xb7e151628aed2a6a)) << 64 |
+                                   UINT64_C(0xbf7158809cf4f3c7);
+    static constexpr type Q = type(UINT64_C(0x9e3779b97f4a7c15)) << 64 |
+                                   UINT64_C(0xf39cc0605cedc835);
+};
+#endif
+
+template <int W> using word_t = typename word<W>::type;
+
+/* Key schedules; S holds the round keys in rc6.c's order          */
+template <int W, int R> struct rc6_schedule {
+    static_assert(R >= 0 && R <= 255, "r must be in 0..255");
+    word_t<W> S[2*R+4];
+};
+template <int W, int R> struct rc5_schedule {
+    static_assert(R >= 0 && R <= 255, "r must be in 0..255");
+    word_t<W> S[2*R+2];
+};
+
+template <int W> using rc6_block = std::array<unsigned char, W/2>;
+template <int W> using rc5_block = std::array<unsigned char, W/4>;
+
+namespace detail {
+
+/* Arithmetic in at least unsigned int, so uint8_t and uint16_t do
+ * not promote to (overflowing) int                                */
+template <int W> using wide_t = decltype(word_t<W>() + 0u);
+
+template <int W> constexpr int lgw() { return W==8 ? 3 : W==16 ? 4 :
+                                              W==32 ? 5 : W==64 ? 6 : 7; }
+
+/* Shift counts stay below W, including for d = 0, in the form
+ * compilers recognize as a rotate instruction                     */
+template <int W> constexpr word_t<W> rotl(word_t<W> x, unsigned d) {
+    d &= W-1;
+    return word_t<W>(wide_t<W>(x) << d | wide_t<W>(x) >> (-d & (W-1)));
+}
+template <int W> constexpr word_t<W> rotr(word_t<W> x, unsigned d) {
+    d &= W-1;
+    return word_t<W>(wide_t<W>(x) >> d | wide_t<W>(x) << (-d & (W-1)));
+}
+template <int W> constexpr word_t<W> add(word_t<W> a, word_t<W> b) {
+    return word_t<W>(wide_t<W>(a) + b);
+}
+template <int W> constexpr word_t<W> sub(word_t<W> a, word_t<W> b) {
+    return word_t<W>(wide_t<W>(a) - b);
+}
+/* RC6's f(x) = rotl(x*(2x+1), lg w)                                */
+template <int W> constexpr word_t<W> f(word_t<W> x) {
+    wide_t<W> y = x;
+    return rotl<W>(word_t<W>(y * (2*y + 1)), lgw<W>());
+}
+template <int W> constexpr unsigned amt(word_t<W> x) {
+    return unsigned(x & (W-1));
+}
+
+/* Every function on a block is forced inline, so a call site with
+ * a constant schedule size compiles to straight-line code          */
+#if defined(__GNUC__)
+#define RC6_INLINE [[gnu::always_inline]] inline
+#define RC6_UNROLL(n) _Pragma(#n)
+#else
+#define RC6_INLINE inline
+#define RC6_UNROLL(n)
+#endif
+
+/* Little-endian word i of a block; compilers turn these loops into
+ * a single load or store                                          */
+template <int W>
+RC6_INLINE constexpr word_t<W> load(const unsigned char *b, int i) {
+    word_t<W> x = 0;
+    RC6_UNROLL(GCC unroll 16)
+    for (int j=W/8-1; j>=0; j--)
+        x = word_t<W>(wide_t<W>(x) << 4 << 4 | b[i*(W/8) + j]);
+    return x;
+}
+template <int W>
+RC6_INLINE constexpr void store(unsigned char *b, int i, word_t<W> x) {
+    RC6_UNROLL(GCC unroll 16)
+    for (int j=0; j<W/8; j++, x = word_t<W>(wide_t<W>(x) >> 4 >> 4))
+        b[i*(W/8) + j] = (unsigned char)x;
+}
+
+/* Both ciphers share the key expansion; only NS differs. b is at
+ * most 255, so L is sized for that.                               */
+template <int W, int NS>
+constexpr void expand(word_t<W> (&S)[NS], const unsigned char *key, int b) {
+    constexpr int bpw = W/8;
+    word_t<W> L[(255 + bpw-1) / bpw] = {}, A = 0, B = 0;
+    int c = (b ? (b + bpw-1) / bpw : 1), i = 0, j = 0, k = 0;
+    for (i=b-1; i>=0; i--)
+        L[i/bpw] = word_t<W>(wide_t<W>(L[i/bpw]) << 4 << 4 | key[i]);
+    S[0] = word<W>::P;
+    for (i=1; i<NS; i++) S[i] = add<W>(S[i-1], word<W>::Q);
+    for (i=0, j=0, k=0; k < 3*(c > NS ? c : NS); k++) {
+        A = S[i] = rotl<W>(add<W>(add<W>(S[i], A), B), 3);
+        B = L[j] = rotl<W>(add<W>(add<W>(L[j], A), B), amt<W>(add<W>(A, B)));
+        if (++i == NS) i = 0;
+        if (++j == c) j = 0;
+    }
+    for (i=0; i<c; i++) L[i] = 0;
+}
+
+/* The block functions; in and out may be equal                    */
+template <int W, int R>
+RC6_INLINE constexpr void enc6(const word_t<W> *S, const unsigned char *in,
+                               unsigned char *out) {
+    word_t<W> A = load<W>(in, 0), B = add<W>(load<W>(in, 1), S[0]);
+    word_t<W> C = load<W>(in, 2), D = add<W>(load<W>(in, 3), S[1]);
+    RC6_UNROLL(GCC unroll 32)
+    for (int i=1; i<=R; i++) {
+        word_t<W> t = f<W>(B), u = f<W>(D);
+        word_t<W> a = add<W>(rotl<W>(A ^ t, amt<W>(u)), S[2*i]);
+        C = add<W>(rotl<W>(C ^ u, amt<W>(t)), S[2*i+1]);
+        A = B; B = C; C = D; D = a;
+    }
+    store<W>(out, 0, add<W>(A, S[2*R+2]));
+    store<W>(out, 1, B);
+    store<W>(out, 2, add<W>(C, S[2*R+3]));
+    store<W>(out, 3, D);
+}
+
+template <int W, int R>
+RC6_INLINE constexpr void dec6(const word_t<W> *S, const unsigned char *in,
+                               unsigned char *out) {
+    word_t<W> A = sub<W>(load<W>(in, 0), S[2*R+2]), B = load<W>(in, 1);
+    word_t<W> C = sub<W>(load<W>(in, 2), S[2*R+3]), D = load<W>(in, 3);
+    RC6_UNROLL(GCC unroll 32)
+    for (int i=R; i>=1; i--) {
+        word_t<W> x = D;
+        D = C; C = B; B = A; A = x;
+        word_t<W> t = f<W>(B), u = f<W>(D);
+        C = rotr<W>(sub<W>(C, S[2*i+1]), amt<W>(t)) ^ u;
+        A = rotr<W>(sub<W>(A, S[2*i]), amt<W>(u)) ^ t;
+    }
+    store<W>(out, 0, A);
+    store<W>(out, 1, sub<W>(B, S[0]));
+    store<W>(out, 2, C);
+    store<W>(out, 3, sub<W>(D, S[1]));
+}
+
+template <int W, int R>
+RC6_INLINE constexpr void enc5(const word_t<W> *S, const unsigned char *in,
+                               unsigned char *out) {
+    word_t<W> A = add<W>(load<W>(in, 0), S[0]);
+    word_t<W> B = add<W>(load<W>(in, 1), S[1]);
+    RC6_UNROLL(GCC unroll 32)
+    for (int i=1; i<=R; i++) {
+        A = add<W>(rotl<W>(A ^ B, amt<W>(B)), S[2*i]);
+        B = add<W>(rotl<W>(B ^ A, amt<W>(A)), S[2*i+1]);
+    }
+    store<W>(out, 0, A);
+    store<W>(out, 1, B);
+}
+
+template <int W, int R>
+RC6_INLINE constexpr void dec5(const word_t<W> *S, const unsigned char *in,
+                               unsigned char *out) {
+    word_t<W> A = load<W>(in, 0), B = load<W>(in, 1);
+    RC6_UNROLL(GCC unroll 32)
+    for (int i=R; i>=1; i--) {
+        B = rotr<W>(sub<W>(B, S[2*i+1]), amt<W>(A)) ^ A;
+        A = rotr<W>(sub<W>(A, S[2*i]), amt<W>(B)) ^ B;
+    }
+    store<W>(out, 0, sub<W>(A, S[0]));
+    store<W>(out, 1, sub<W>(B, S[1]));
+}
+
+} /* namespace detail */
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * R C 6
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+template <int W, int R, std::size_t B>
+constexpr rc6_schedule<W, R> rc6_setup(const std::array<unsigned char, B> &key) {
+    static_assert(B <= 255, "key must be at most 255 bytes");
+    rc6_schedule<W, R> k{};
+    detail::expand<W>(k.S, key.data(), int(B));
+    return k;
+}
+
+template <int W, int R>
+constexpr rc6_block<W> rc6_encrypt(const rc6_schedule<W, R> &k,
+                                   const rc6_block<W> &pt) {
+    rc6_block<W> ct{};
+    detail::enc6<W, R>(k.S, pt.data(), ct.data());
+    return ct;
+}
+
+template <int W, int R>
+constexpr rc6_block<W> rc6_decrypt(const rc6_schedule<W, R> &k,
+                                   const rc6_block<W> &ct) {
+    rc6_block<W> pt{};
+    detail::dec6<W, R>(k.S, ct.data(), pt.data());
+    return pt;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * R C 5
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+template <int W, int R, std::size_t B>
+constexpr rc5_schedule<W, R> rc5_setup(const std::array<unsigned char, B> &key) {
+    static_assert(B <= 255, "key must be at most 255 bytes");
+    rc5_schedule<W, R> k{};
+    detail::expand<W>(k.S, key.data(), int(B));
+    return k;
+}
+
+template <int W, int R>
+constexpr rc5_block<W> rc5_encrypt(const rc5_schedule<W, R> &k,
+                                   const rc5_block<W> &pt) {
+    rc5_block<W> ct{};
+    detail::enc5<W, R>(k.S, pt.data(), ct.data());
+    return ct;
+}
+
+template <int W, int R>
+constexpr rc5_block<W> rc5_decrypt(const rc5_schedule<W, R> &k,
+                                   const rc5_block<W> &ct) {
+    rc5_block<W> pt{};
+    detail::dec5<W, R>(k.S, ct.data(), pt.data());
+    return pt;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * T Y P E D   K E Y S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifdef RC6_HPP_SPAN
+/* A schedule whose w and r are part of its type. The block functions
+ * take fixed-extent spans and are forced inline, so a hot call site
+ * becomes the rounds themselves: no call, no spilled arguments, no
+ * run-time w or r, and at -O2 or above the round loop is unrolled. */
+template <int W, int R> class Rc6Key {
+  public:
+    static constexpr std::size_t block_bytes = W/2;
+    typedef std::span<const unsigned char, W/2> in_block;
+    typedef std::span<unsigned char, W/2> out_block;
+
+    template <std::size_t B>
+    constexpr explicit Rc6Key(const std::array<unsigned char, B> &key)
+        : k(rc6_setup<W, R>(key)) {}
+    /* Throws std::length_error for keys over 255 bytes            */
+    explicit Rc6Key(std::span<const unsigned char> key) : k{} {
+        if (key.size() > 255) throw std::length_error("RC6 key too long");
+        detail::expand<W>(k.S, key.data(), int(key.size()));
+    }
+
+    /* in and out may be the same block                            */
+    RC6_INLINE constexpr void encrypt(in_block in, out_block out) const {
+        detail::enc6<W, R>(k.S, in.data(), out.data());
+    }
+    RC6_INLINE constexpr void decrypt(in_block in, out_block out) const {
+        detail::dec6<W, R>(k.S, in.data(), out.data());
+    }
+
+    constexpr const rc6_schedule<W, R> &schedule() const { return k; }
+
+  private:
+    rc6_schedule<W, R> k;
+};
+
+template <int W, int R> class Rc5Key {
+  public:
+    static constexpr std::size_t block_bytes = W/4;
+    typedef std::span<const unsigned char, W/4> in_block;
+    typedef std::span<unsigned char, W/4> out_block;
+
+    template <std::size_t B>
+    constexpr explicit Rc5Key(const std::array<unsigned char, B> &key)
+        : k(rc5_setup<W, R>(key)) {}
+    explicit Rc5Key(std::span<const unsigned char> key) : k{} {
+        if (key.size() > 255) throw std::length_error("RC5 key too long");
+        detail::expand<W>(k.S, key.data(), int(key.size()));
+    }
+
+    RC6_INLINE constexpr void encrypt(in_block in, out_block out) const {
+        detail::enc5<W, R>(k.S, in.data(), out.data());
+    }
+    RC6_INLINE constexpr void decrypt(in_block in, out_block out) const {
+        detail::dec5<W, R>(k.S, in.data(), out.data());
+    }
+
+    constexpr const rc5_schedule<W, R> &schedule() const { return k; }
+
+  private:
+    rc5_schedule<W, R> k;
+};
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * S E L F - T E S T
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef RC6_HPP_NO_SELFTEST
+namespace selftest {
+
+/* Bytes 0, 1, ..., N-1: the key and plaintext of the draft vectors */
+template <std::size_t N> constexpr std::array<unsigned char, N> seq() {
+    std::array<unsigned char, N> a{};
+    for (std::size_t i=0; i<N; i++) a[i] = (unsigned char)i;
+    return a;
+}
+
+/* Bytes of a hex string literal                                   */
+template <std::size_t N>
+constexpr std::array<unsigned char, (N-1)/2> hex(const char (&s)[N]) {
+    std::array<unsigned char, (N-1)/2> a{};
+    for (std::size_t i=0; i<(N-1)/2; i++) {
+        int h = s[2*i], l = s[2*i+1];
+        h = (h <= '9' ? h-'0' : h-'A'+10);
+        l = (l <= '9' ? l-'0' : l-'A'+10);
+        a[i] = (unsigned char)(h << 4 | l);
+    }
+    return a;
+}
+
+/* std::array's == is constexpr only from C++20                   */
+template <std::size_t N>
+constexpr bool equal(const std::array<unsigned char, N> &a,
+                     const std::array<unsigned char, N> &b) {
+    for (std::size_t i=0; i<N; i++)
+        if (a[i] != b[i]) return false;
+    return true;
+}
+
+template <int W, int R, int B, std::size_t N>
+constexpr bool rc6_ok(const char (&ct)[N]) {
+    constexpr auto k = rc6_setup<W, R>(seq<B>());
+    return equal(rc6_encrypt(k, seq<W/2>()), hex(ct)) &&
+           equal(rc6_decrypt(k, hex(ct)), seq<W/2>());
+}
+template <int W, int R, int B, std::size_t N>
+constexpr bool rc5_ok(const char (&ct)[N]) {
+    constexpr auto k = rc5_setup<W, R>(seq<B>());
+    return equal(rc5_encrypt(k, seq<W/4>()), hex(ct)) &&
+           equal(rc5_decrypt(k, hex(ct)), seq<W/4>());
+}
+
+static_assert(rc6_ok<8, 12, 4>("AEFC4612"), "RC6-8/12/4");
+static_assert(rc6_ok<16, 16, 8>("2FF0B68EAEFFAD5B"), "RC6-16/16/8");
+static_assert(rc6_ok<32, 20, 16>("3A96F9C7F6755CFE46F00E3DCD5D2A3C"),
+              "RC6-32/20/16");
+static_assert(rc6_ok<64, 24, 24>("C002DE050BD55E5D36864AB9853338E6"
+                                 "DC4A1326C6BDAAEB1BC9E4FD67886617"),
+              "RC6-64/24/24");
+static_assert(rc5_ok<8, 12, 4>("212A"), "RC5-8/12/4");
+static_assert(rc5_ok<16, 16, 8>("23A8D72E"), "RC5-16/16/8");
+static_assert(rc5_ok<32, 20, 16>("2A0EDC0E9431FF73"), "RC5-32/20/16");
+static_assert(rc5_ok<64, 24, 24>("A46772820EDBCE0235ABEA32AE7178DA"),
+              "RC5-64/24/24");
+#ifdef __SIZEOF_INT128__
+static_assert(rc6_ok<128, 28, 32>(
+                  "4ED87C64BAFFECD4303EE6A79AAFAEF575B351C024272BE70A70B4A3"
+                  "92CFC157DBA52D529A79E83845BF43D67545383AED3DBF4F0D23640E"
+                  "44CBF6CDAA034DCB"), "RC6-128/28/32");
+static_assert(rc5_ok<128, 28, 32>("ECA5910921A4F4CFDD7AD7AD20A1FCBA"
+                                  "068EC7A7CD752D68FE914B7FE180B440"),
+              "RC5-128/28/32");
+#endif
+
+} /* namespace selftest */
+#endif
+
+} /* namespace rc6 */
+
+#endif
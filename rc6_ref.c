@@ -39,6 +39,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "rc6.h"
+#include "probes.h"
 
 /* set vectors non-zero to print intermediate setup/encrypt values */
 int vectors = 0;
@@ -198,10 +199,14 @@ static int setup(void *rkey, int rk_words,
     }
 }
 int rc5_setup(void *rkey, int w, int r, int b, void *key) {
-    return setup(rkey, 2*r+2, w, r, b, key);
+    int ret = setup(rkey, 2*r+2, w, r, b, key);
+    PROBE5(setup, 5, w, r, b, ret);
+    return ret;
 }
 int rc6_setup(void *rkey, int w, int r, int b, void *key) {
-    return setup(rkey, 2*r+4, w, r, b, key);
+    int ret = setup(rkey, 2*r+4, w, r, b, key);
+    PROBE5(setup, 6, w, r, b, ret);
+    return ret;
 }
 
 void rc5_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
@@ -246,7 +251,22 @@ void rc5_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
     for (i=0; i<n; i++) { p[n-i-1] = A[i]; p[2*n-i-1] = B[i]; }
 }
 
-void rc6_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
+/* Tweak injection j (see rc6.h): d0 += T[j%3], d1 += T[(j+1)%3]+j.
+ * T holds T0, T1, T0^T1 as n-byte big-endian words. op is add/sub. */
+static void inject(void (*op)(unsigned char *, unsigned char *,
+                              unsigned char *, int),
+                   unsigned char d0[], unsigned char d1[],
+                   unsigned char T[], int j, int n) {
+    unsigned char J[MAXSZ] = {0};
+    J[n-1] = j;
+    op(d0, d0, T+j%3*n, n);
+    op(d1, d1, T+(j+1)%3*n, n);
+    op(d1, d1, J, n);
+}
+
+/* RC6 with tweak T as above, or plain RC6 when T is NULL          */
+static void encrypt6(void *rkey, int w, int r, unsigned char *T,
+                     void *pt, void *ct) {
     unsigned char A[MAXSZ], B[MAXSZ], C[MAXSZ], D[MAXSZ];
     unsigned char t[MAXSZ], u[MAXSZ];
     unsigned char *rk = (unsigned char *)rkey,
@@ -259,6 +279,7 @@ void rc6_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
         C[i] = p[3*n-i-1];   D[i] = p[4*n-i-1];
     }
     add(B,B,rk,n); add(D,D,rk+n,n);
+    if (T) inject(add, B, D, T, 0, n);
     if (vectors) { pbuf(B,n,"B = "); pbuf(D,n,"D = "); }
     for (i=1; i<=r; i++) {
         rotl(t, B, 1, n); t[n-1] |= 1;       /* t = 2*B+1          */
@@ -269,11 +290,13 @@ void rc6_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
         eor(A,A,t,n); rotl(A,A,rot_amt,n); add(A,A,rk+2*i*n,n);
         rot_amt = bits(t,n,lgw);
         eor(C,C,u,n); rotl(C,C,rot_amt,n); add(C,C,rk+2*i*n+n,n);
+        if (T && i%4 == 0 && i < r) inject(add, A, C, T, i/4, n);
         if (vectors) { pbuf(A,n,"A = "); pbuf(C,n,"C = "); }
         memcpy(t,A,n);memcpy(A,B,n);memcpy(B,C,n);
         memcpy(C,D,n);memcpy(D,t,n);
     }
     add(A,A,rk+(2*r+2)*n,n); add(C,C,rk+(2*r+3)*n,n);
+    if (T) inject(add, A, C, T, (r+3)/4, n);
     if (vectors) { pbuf(A,n,"A = "); pbuf(C,n,"C = "); }
     /* Write A/B/C/D in byte-reverse order */
     for (i=0; i<n; i++) {
@@ -282,7 +305,8 @@ void rc6_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
     }
 }
 
-void rc6_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
+static void decrypt6(void *rkey, int w, int r, unsigned char *T,
+                     void *ct, void *pt) {
     unsigned char A[MAXSZ], B[MAXSZ], C[MAXSZ], D[MAXSZ];
     unsigned char t[MAXSZ], u[MAXSZ];
     unsigned char *rk = (unsigned char *)rkey,
@@ -295,6 +319,7 @@ void rc6_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
         C[i] = c[3*n-i-1];   D[i] = c[4*n-i-1];
     }
     sub(A,A,rk+(2*r+2)*n,n); sub(C,C,rk+(2*r+3)*n,n);
+    if (T) inject(sub, A, C, T, (r+3)/4, n);
     for (i=r; i>=1; i--) {
         memcpy(t,D,n);memcpy(D,C,n);memcpy(C,B,n);
         memcpy(B,A,n);memcpy(A,t,n);
@@ -302,15 +327,77 @@ void rc6_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
         rotl(u, D, 1, n); u[n-1] |= 1;       /* u = 2*D+1          */
         mul(t, t, B, n); rotl(t, t, lgw, n); /* t = rotl(B*t, lgw) */
         mul(u, u, D, n); rotl(u, u, lgw, n); /* u = rotl(D*u, lgw) */
+        if (T && i%4 == 0 && i < r) inject(sub, A, C, T, i/4, n);
         rot_amt = bits(t,n,lgw);
         sub(C,C,rk+2*i*n+n,n); rotl(C,C,w-rot_amt,n); eor(C,C,u,n);
         rot_amt = bits(u,n,lgw);
         sub(A,A,rk+2*i*n,n); rotl(A,A,w-rot_amt,n); eor(A,A,t,n);
     }
     sub(B,B,rk,n); sub(D,D,rk+n,n);
+    if (T) inject(sub, B, D, T, 0, n);
     /* Write A/B/C/D in byte-reverse order */
     for (i=0; i<n; i++) {
         p[n-i-1] = A[i];     p[2*n-i-1] = B[i];
         p[3*n-i-1] = C[i];   p[4*n-i-1] = D[i];
     }
 }
+
+void rc6_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
+    encrypt6(rkey, w, r, NULL, pt, ct);
+}
+
+void rc6_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
+    decrypt6(rkey, w, r, NULL, ct, pt);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * T W E A K A B L E   R C 6
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* T = T0, T1, T0^T1 from tweak words stored like block words       */
+static void tload(unsigned char T[], unsigned char *tw, int n) {
+    int i;
+    for (i=0; i<n; i++) { T[i] = tw[n-i-1]; T[n+i] = tw[2*n-i-1]; }
+    eor(T+2*n, T, T+n, n);
+    if (vectors) pbuf(T, 3*n, "T = ");
+}
+
+/* T0 += 1 (mod 2^w), in place in the caller's byte order          */
+static void tnext(unsigned char tw[], int n) {
+    int i;
+    for (i=0; i<n && ++tw[i]==0; i++) ;
+}
+
+void rc6t_encrypt(void *rkey, int w, int r, void *tweak,
+                  void *pt, void *ct) {
+    unsigned char T[3*MAXSZ];
+    tload(T, (unsigned char *)tweak, w/8);
+    encrypt6(rkey, w, r, T, pt, ct);
+}
+
+void rc6t_decrypt(void *rkey, int w, int r, void *tweak,
+                  void *ct, void *pt) {
+    unsigned char T[3*MAXSZ];
+    tload(T, (unsigned char *)tweak, w/8);
+    decrypt6(rkey, w, r, T, ct, pt);
+}
+
+void rc6t_encryptn(void *rkey, int w, int r, void *tweak,
+                   void *pt, void *ct, size_t nblocks) {
+    unsigned char tw[2*MAXSZ];
+    size_t k;
+    memcpy(tw, tweak, w/4);
+    for (k=0; k<nblocks; k++, tnext(tw, w/8))
+        rc6t_encrypt(rkey, w, r, tw, (char *)pt + k*w/2,
+                     (char *)ct + k*w/2);
+}
+
+void rc6t_decryptn(void *rkey, int w, int r, void *tweak,
+                   void *ct, void *pt, size_t nblocks) {
+    unsigned char tw[2*MAXSZ];
+    size_t k;
+    memcpy(tw, tweak, w/4);
+    for (k=0; k<nblocks; k++, tnext(tw, w/8))
+        rc6t_decrypt(rkey, w, r, tw, (char *)ct + k*w/2,
+                     (char *)pt + k*w/2);
+}
@@ -0,0 +1,47 @@
+/*
+// Multi-block RC6-8 and RC6-16 with a table-driven round function.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* With w=8 or w=16 the RC6 function f(x) = rotl(x*(2x+1), lg w) has
+ * only 256 or 65536 inputs, so it can be a key-independent table,
+ * built once per process. These functions encipher RC6S_LANES blocks
+ * at a time, one per lane, with f computed by one of:
+ *
+ *   RC6S_ARITH   multiply and rotate, vectorized by the compiler
+ *   RC6S_TABLE   table lookup, one load per lane
+ *   RC6S_GATHER  table lookup with AVX2 vpgatherdd
+ *   RC6S_PERMB   w=8 only: the 256-byte table held in four registers
+ *                and read with AVX-512 VBMI vpermi2b
+ *
+ * RC6S_AUTO picks the fastest available. rkey is an rc6w_setup
+ * schedule for the same w and r; any r in 0..255 is accepted. Block
+ * bytes and results are those of rc6.c and rc6_ref.c. The plain
+ * functions have the blkn_fn shape of modes.h and use RC6S_AUTO.
+ */
+#ifndef RC6_SMALL_H
+#define RC6_SMALL_H
+
+#include <stddef.h>
+
+#define RC6S_LANES 64
+
+enum { RC6S_AUTO, RC6S_ARITH, RC6S_TABLE, RC6S_GATHER, RC6S_PERMB };
+
+/* Nonzero iff kind can run with this w on this CPU                */
+int rc6s_available(int kind, int w);
+
+void rc6s_encrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks);
+void rc6s_decrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks);
+
+/* As above with a given kind, which must be available            */
+void rc6s_encrypt_with(int kind, void *rkey, int w, int r,
+                       void *in, void *out, size_t nblocks);
+void rc6s_decrypt_with(int kind, void *rkey, int w, int r,
+                       void *in, void *out, size_t nblocks);
+
+#endif
@@ -0,0 +1,228 @@
+/*
+// Portable multi-block RC6 & RC5 for w = 8, 16, 32 and 64 with GCC
+// vector extensions.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - At run-time: w is 8, 16, 32 or 64 and r in 0..255.
+ * - rkey from rc6w_setup/rc5w_setup for the same w and r.
+ * - GCC 4.9+ or Clang: vector_size types, vector subscripts, and
+ *   operations mixing vectors and scalars.
+ * - Build with -O2 or more and the target's SIMD enabled (eg,
+ *   -march=native, -mcpu=power9, -march=z14, -march=rv64gcv).
+ *
+ * The element type of each vector is exactly w bits wide, so adds,
+ * multiplies and shifts wrap mod 2^w with no masking. Rotates use
+ * x << (s&(w-1)) | x >> (-s&(w-1)), which is defined for every count
+ * and which compilers match to a rotate instruction where one exists.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "rc6_wide.h"
+#include "rc6_vec.h"
+#include "probes.h"
+
+#define VB RC6X_VEC_BYTES
+
+/* Host byte order, folded at compile time                         */
+static int little(void) {
+    const union { unsigned x; unsigned char endian; } u = { 1 };
+    return u.endian;
+}
+
+/* Rotates and f on vectors of w-bit words. Macros rather than
+ * functions, since passing vectors wider than the target's by value
+ * has no stable ABI.                                              */
+#define ROTL(x, s, w)   ((x) << ((s) & (w-1)) | (x) >> (-(s) & (w-1)))
+#define ROTR(x, s, w)   ((x) >> ((s) & (w-1)) | (x) << (-(s) & (w-1)))
+#define F(y, x, w, lgw) (y = (x) * (2*(x) + 1), y << lgw | y >> (w-lgw))
+
+/* Batch of blocks: in to out, round keys S                         */
+typedef void (*batch_fn)(const uint64_t *S, int r,
+                         const unsigned char *in, unsigned char *out);
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * K E R N E L S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Defines, for w-bit words of type T and lg w = LGW, the vector type
+ * V<w>, load/store between nw-word blocks and lanes, and batch
+ * functions rc6e<w>, rc6d<w>, rc5e<w> and rc5d<w>. Vectors are only
+ * passed by pointer.                                               */
+#define KERNELS(w, T, LGW)                                              \
+typedef T V##w __attribute__((vector_size(VB)));                        \
+enum { N##w = VB / sizeof(T) };                                         \
+                                                                        \
+static void load##w(V##w *W, int nw, const unsigned char *p) {          \
+    int j, v, b;                                                        \
+    for (j=0; j<N##w; j++) {                                            \
+        for (v=0; v<nw; v++, p+=sizeof(T)) {                            \
+            T x = 0;                                                    \
+            if (little()) memcpy(&x, p, sizeof(T));                     \
+            else for (b=0; b<(int)sizeof(T); b++) x |= (T)p[b] << 8*b;  \
+            W[v][j] = x;                                                \
+        }                                                               \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+static void store##w(const V##w *W, int nw, unsigned char *p) {         \
+    int j, v, b;                                                        \
+    for (j=0; j<N##w; j++) {                                            \
+        for (v=0; v<nw; v++, p+=sizeof(T)) {                            \
+            T x = W[v][j];                                              \
+            if (little()) memcpy(p, &x, sizeof(T));                     \
+            else for (b=0; b<(int)sizeof(T); b++) p[b] = x >> 8*b;      \
+        }                                                               \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+static void rc6e##w(const uint64_t *S, int r,                           \
+                    const unsigned char *in, unsigned char *out) {      \
+    V##w W[4], A, B, C, D, t, u, y;                                     \
+    int i;                                                              \
+    load##w(W, 4, in);                                                  \
+    A = W[0]; B = W[1] + (T)S[0]; C = W[2]; D = W[3] + (T)S[1];         \
+    for (i=1; i<=r; i++) {                                              \
+        t = F(y, B, w, LGW);                                            \
+        u = F(y, D, w, LGW);                                            \
+        A = ROTL(A^t, u, w) + (T)S[2*i];                                \
+        C = ROTL(C^u, t, w) + (T)S[2*i+1];                              \
+        t=A; A=B; B=C; C=D; D=t;                                        \
+    }                                                                   \
+    W[0] = A + (T)S[2*r+2]; W[1] = B; W[2] = C + (T)S[2*r+3]; W[3] = D; \
+    store##w(W, 4, out);                                                \
+}                                                                       \
+                                                                        \
+static void rc6d##w(const uint64_t *S, int r,                           \
+                    const unsigned char *in, unsigned char *out) {      \
+    V##w W[4], A, B, C, D, t, u, y;                                     \
+    int i;                                                              \
+    load##w(W, 4, in);                                                  \
+    A = W[0] - (T)S[2*r+2]; B = W[1]; C = W[2] - (T)S[2*r+3]; D = W[3]; \
+    for (i=r; i>=1; i--) {                                              \
+        t=D; D=C; C=B; B=A; A=t;                                        \
+        u = F(y, D, w, LGW);                                            \
+        t = F(y, B, w, LGW);                                            \
+        C = ROTR(C - (T)S[2*i+1], t, w) ^ u;                            \
+        A = ROTR(A - (T)S[2*i], u, w) ^ t;                              \
+    }                                                                   \
+    W[0] = A; W[1] = B - (T)S[0]; W[2] = C; W[3] = D - (T)S[1];         \
+    store##w(W, 4, out);                                                \
+}                                                                       \
+                                                                        \
+static void rc5e##w(const uint64_t *S, int r,                           \
+                    const unsigned char *in, unsigned char *out) {      \
+    V##w W[2], A, B;                                                    \
+    int i;                                                              \
+    load##w(W, 2, in);                                                  \
+    A = W[0] + (T)S[0]; B = W[1] + (T)S[1];                             \
+    for (i=1; i<=r; i++) {                                              \
+        A = ROTL(A^B, B, w) + (T)S[2*i];                                \
+        B = ROTL(B^A, A, w) + (T)S[2*i+1];                              \
+    }                                                                   \
+    W[0] = A; W[1] = B;                                                 \
+    store##w(W, 2, out);                                                \
+}                                                                       \
+                                                                        \
+static void rc5d##w(const uint64_t *S, int r,                           \
+                    const unsigned char *in, unsigned char *out) {      \
+    V##w W[2], A, B;                                                    \
+    int i;                                                              \
+    load##w(W, 2, in);                                                  \
+    A = W[0]; B = W[1];                                                 \
+    for (i=r; i>=1; i--) {                                              \
+        B = ROTR(B - (T)S[2*i+1], A, w) ^ A;                            \
+        A = ROTR(A - (T)S[2*i], B, w) ^ B;                              \
+    }                                                                   \
+    W[0] = A - (T)S[0]; W[1] = B - (T)S[1];                             \
+    store##w(W, 2, out);                                                \
+}
+
+KERNELS(8, uint8_t, 3)
+KERNELS(16, uint16_t, 4)
+KERNELS(32, uint32_t, 5)
+KERNELS(64, uint64_t, 6)
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * B A T C H E S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+int rc6x_supported(int w) {
+    return w == 8 || w == 16 || w == 32 || w == 64;
+}
+
+/* Run fn over whole batches of n blocks of bpb bytes, then pad the
+ * tail into a full batch                                          */
+static void run(batch_fn fn, const char *what, int n, int bpb,
+                void *rkey, int w, int r, void *in, void *out,
+                size_t nblocks) {
+    const unsigned char *p = (const unsigned char *)in;
+    unsigned char *q = (unsigned char *)out;
+    size_t len = nblocks*bpb;
+    PROBE4(bulk_entry, what, len, w, r);
+    for ( ; nblocks >= (size_t)n; nblocks-=n, p+=n*bpb, q+=n*bpb)
+        fn((const uint64_t *)rkey, r, p, q);
+    if (nblocks) {
+        unsigned char buf[4*VB];
+        memset(buf, 0, sizeof(buf));
+        memcpy(buf, p, nblocks*bpb);
+        fn((const uint64_t *)rkey, r, buf, buf);
+        memcpy(q, buf, nblocks*bpb);
+    }
+    PROBE4(bulk_exit, what, len, w, r);
+}
+
+/* Batch function and lanes for w; idx is rc6e, rc6d, rc5e, rc5d   */
+static batch_fn pick(int w, int idx, int *n) {
+    static const batch_fn fn[4][4] = {
+        { rc6e8,  rc6d8,  rc5e8,  rc5d8  },
+        { rc6e16, rc6d16, rc5e16, rc5d16 },
+        { rc6e32, rc6d32, rc5e32, rc5d32 },
+        { rc6e64, rc6d64, rc5e64, rc5d64 } };
+    int k = (w == 8 ? 0 : w == 16 ? 1 : w == 32 ? 2 : 3);
+    *n = VB / (w/8);
+    return fn[k][idx];
+}
+
+void rc6x_encrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks) {
+    int n;
+    batch_fn fn = pick(w, 0, &n);
+    run(fn, "rc6x", n, w/2, rkey, w, r, in, out, nblocks);
+}
+void rc6x_decrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks) {
+    int n;
+    batch_fn fn = pick(w, 1, &n);
+    run(fn, "rc6x", n, w/2, rkey, w, r, in, out, nblocks);
+}
+void rc5x_encrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks) {
+    int n;
+    batch_fn fn = pick(w, 2, &n);
+    run(fn, "rc5x", n, w/4, rkey, w, r, in, out, nblocks);
+}
+void rc5x_decrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks) {
+    int n;
+    batch_fn fn = pick(w, 3, &n);
+    run(fn, "rc5x", n, w/4, rkey, w, r, in, out, nblocks);
+}
+
+void blkcipher_rc6x(blkcipher *bc, void *rkey, int w, int r) {
+    bc->enc = rc6w_encrypt; bc->dec = rc6w_decrypt;
+    bc->encn = rc6x_encrypt; bc->decn = rc6x_decrypt;
+    bc->rkey = rkey; bc->w = w; bc->r = r; bc->bpb = w/2;
+    bc->lanes = VB*8/w;
+}
+
+void blkcipher_rc5x(blkcipher *bc, void *rkey, int w, int r) {
+    bc->enc = rc5w_encrypt; bc->dec = rc5w_decrypt;
+    bc->encn = rc5x_encrypt; bc->decn = rc5x_decrypt;
+    bc->rkey = rkey; bc->w = w; bc->r = r; bc->bpb = w/4;
+    bc->lanes = VB*8/w;
+}
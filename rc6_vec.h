@@ -0,0 +1,53 @@
+/*
+// Portable multi-block RC6 & RC5 for w = 8, 16, 32 and 64 with GCC
+// vector extensions.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Words are held in vectors declared with vector_size, one block per
+ * lane, and the rounds are written with ordinary operators on them,
+ * so GCC and Clang emit whatever SIMD the target has (SSE/AVX, NEON,
+ * AltiVec/VSX, z/Arch vector, RVV) and fall back to scalar code
+ * where there is none. No intrinsics are used.
+ *
+ * A vector is RC6X_VEC_BYTES bytes, so a batch is RC6X_VEC_BYTES*8/w
+ * blocks: 64 at w=8 down to 8 at w=64 with the default of 64 bytes.
+ * Vectors wider than the hardware's are split by the compiler and
+ * give it independent work to interleave. Any nblocks is accepted; a
+ * final partial batch is padded.
+ *
+ * The round keys are those of rc6w_setup/rc5w_setup and results match
+ * rc6.c, rc6_wide.c and rc6_ref.c on hosts of either byte order. The
+ * functions have the blkn_fn shape of modes.h.
+ */
+#ifndef RC6_VEC_H
+#define RC6_VEC_H
+
+#include <stddef.h>
+#include "modes.h"
+
+#ifndef RC6X_VEC_BYTES
+#define RC6X_VEC_BYTES 64   /* Bytes per vector, a power of two      */
+#endif
+
+/* Nonzero iff rc6x_/rc5x_ functions accept this w                  */
+int rc6x_supported(int w);
+
+void rc6x_encrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks);
+void rc6x_decrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks);
+void rc5x_encrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks);
+void rc5x_decrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks);
+
+/* Like blkcipher_rc6/rc5 of modes.h over an rc6w/rc5w schedule, with
+ * these functions as encn/decn and lanes set to their batch.
+ */
+void blkcipher_rc6x(blkcipher *bc, void *rkey, int w, int r);
+void blkcipher_rc5x(blkcipher *bc, void *rkey, int w, int r);
+
+#endif
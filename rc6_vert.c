@@ -0,0 +1,307 @@
+/*
+// Multi-block RC6 & RC5 for wide words, one block per vector lane.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - At run-time: w%64==0, 128 <= w <= 1024, and r in 0..255.
+ * - rkey from rc6w_setup/rc5w_setup for the same w and r.
+ * - Written for auto-vectorization: build with -O3 (or -O2
+ *   -ftree-vectorize) and -march for the widest vectors available.
+ *
+ * Each word is nl = w/32 limbs of 32 bits, and each limb is an array
+ * over the lanes. 32-bit limbs make every partial product a 32x32->64
+ * multiply, which vector units have, and keep the lane loops free of
+ * carries between lanes.
+ *
+ * RC6V_LANES is 32, two 512-bit vectors of limbs: GCC completely
+ * unrolls loops of 16 or fewer iterations before the vectorizer sees
+ * them, and 16 lanes ran 4-8 times slower than 32 for that reason.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "rc6_wide.h"
+#include "rc6_vert.h"
+#include "probes.h"
+#include "transpose.h"
+
+#define L RC6V_LANES
+#define NL 32           /* Limbs in the largest word, w=1024        */
+
+typedef uint32_t word[NL][L];
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * L A N E   A R I T H M E T I C
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Limb i of round key k, from rc6w's 64-bit little-endian limbs   */
+static uint32_t klimb(const uint64_t *S, int nl, int k, int i) {
+    return (uint32_t)(S[k*(nl/2) + i/2] >> 32*(i&1));
+}
+
+/* x += round key k in every lane                                  */
+static void addk(int nl, word x, const uint64_t *S, int k) {
+    uint32_t c[L] = {0};
+    int i, j;
+    for (i=0; i<nl; i++) {
+        uint32_t s = klimb(S, nl, k, i);
+        for (j=0; j<L; j++) {
+            uint64_t v = (uint64_t)x[i][j] + s + c[j];
+            x[i][j] = (uint32_t)v;
+            c[j] = (uint32_t)(v >> 32);
+        }
+    }
+}
+
+/* x -= round key k in every lane                                  */
+static void subk(int nl, word x, const uint64_t *S, int k) {
+    uint32_t b[L] = {0};
+    int i, j;
+    for (i=0; i<nl; i++) {
+        uint32_t s = klimb(S, nl, k, i);
+        for (j=0; j<L; j++) {
+            uint64_t v = (uint64_t)x[i][j] - s - b[j];
+            x[i][j] = (uint32_t)v;
+            b[j] = (uint32_t)(v >> 63);
+        }
+    }
+}
+
+/* z = x xor y                                                     */
+static void eor(int nl, word z, word x, word y) {
+    int i, j;
+    for (i=0; i<nl; i++)
+        for (j=0; j<L; j++) z[i][j] = x[i][j] ^ y[i][j];
+}
+
+/* z = x * y (mod 2^w), z distinct from x and y. Column k sums the
+ * low halves of its partial products and the high halves of column
+ * k-1's, at most 2*nl terms under 2^32, so it is carried into z as
+ * soon as it is complete.                                         */
+static void mul(int nl, word z, word x, word y) {
+    uint64_t lo[L], hi[L], prev[L] = {0};
+    int i, k, j;
+    for (k=0; k<nl; k++) {
+        memset(lo, 0, sizeof(lo));
+        memset(hi, 0, sizeof(hi));
+        for (i=0; i<=k; i++)
+            for (j=0; j<L; j++) {
+                uint64_t p = (uint64_t)x[i][j] * y[k-i][j];
+                lo[j] += (uint32_t)p;
+                hi[j] += p >> 32;
+            }
+        for (j=0; j<L; j++) {
+            uint64_t v = lo[j] + prev[j];
+            z[k][j] = (uint32_t)v;
+            prev[j] = hi[j] + (v >> 32);
+        }
+    }
+}
+
+/* z = x rotated left s bits, 0 < s < 32, the same in every lane    */
+static void rotc(int nl, word z, word x, int s) {
+    int i, j;
+    for (i=0; i<nl; i++) {
+        int p = (i ? i-1 : nl-1);
+        for (j=0; j<L; j++) z[i][j] = x[i][j] << s | x[p][j] >> (32-s);
+    }
+}
+
+/* x rotated left k[j] bits in lane j, 0 <= k[j] < w. Whole limbs
+ * move by the binary digits of k[j]/32, one select pass per digit,
+ * then the remaining k[j]%32 bits shift across limb boundaries.   */
+static void rotv(int nl, word x, const uint32_t k[L]) {
+    word t[2];
+    int i, j, m, cur = 0;
+    memcpy(t[0], x, nl*sizeof(x[0]));
+    for (m=1; m<nl; m<<=1, cur^=1) {
+        word *a = &t[cur], *b = &t[cur^1];
+        for (i=0; i<nl; i++) {
+            int p = (i >= m ? i-m : i-m+nl);
+            for (j=0; j<L; j++)
+                (*b)[i][j] = (k[j]>>5 & (uint32_t)m ? (*a)[p][j] : (*a)[i][j]);
+        }
+    }
+    for (i=0; i<nl; i++) {
+        int p = (i ? i-1 : nl-1);
+        for (j=0; j<L; j++) {
+            uint32_t s = k[j] & 31;
+            x[i][j] = t[cur][i][j] << s | (t[cur][p][j] >> (31-s)) >> 1;
+        }
+    }
+}
+
+/* k[j] = low lg w bits of x in lane j; w-k[j] (mod w) if inverse   */
+static void bits(int nl, uint32_t k[L], word x, int inverse) {
+    uint32_t w = 32*(uint32_t)nl, m;
+    int j;
+    for (m=1; 2*m <= w; m<<=1) ;
+    for (j=0; j<L; j++) {
+        uint32_t v = x[0][j] & (m-1);
+        k[j] = (inverse && v ? w-v : v);
+    }
+}
+
+/* f(x) = rotl(x*(2x+1), lg w)                                     */
+static void f(int nl, word z, word x) {
+    word t, p;
+    int i, j, lgw;
+    for (lgw=0; (2<<lgw) <= 32*nl; lgw++) ;
+    for (i=nl-1; i>=0; i--)             /* t = 2x+1 (mod 2^w)       */
+        for (j=0; j<L; j++)
+            t[i][j] = x[i][j] << 1 | (i ? x[i-1][j] >> 31 : 1);
+    mul(nl, p, t, x);
+    rotc(nl, z, p, lgw);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * B L O C K S   T O   A N D   F R O M   L A N E S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Rows of words W[a], W[a+1], ... (mod n) for xpose_load/store   */
+static uint32_t **rowp(uint32_t *rows[], word W[], int a, int n) {
+    int v;
+    for (v=0; v<n; v++) rows[v] = W[(a+v)%n][0];
+    return rows;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * A R C 6   A N D   A R C 5   F U N C T I O N S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+int rc6v_supported(int w) {
+    return w >= 128 && w <= 1024 && w%64 == 0;
+}
+
+/* Encipher one batch of L contiguous blocks                      */
+typedef void (*batch_fn)(const xpose *x, const uint64_t *S, int nl, int r,
+                         const unsigned char *in, unsigned char *out);
+
+static void rc6_enc(const xpose *x, const uint64_t *S, int nl, int r,
+                    const unsigned char *in, unsigned char *out) {
+    word W[4], t, u;
+    uint32_t kt[L], ku[L], *rows[4];
+    int i, a = 0;
+    xpose_load(x, in, rowp(rows, W, 0, 4));
+    addk(nl, W[1], S, 0); addk(nl, W[3], S, 1);
+    for (i=1; i<=r; i++, a=(a+1)&3) {
+        uint32_t (*A)[L] = W[a], (*B)[L] = W[(a+1)&3];
+        uint32_t (*C)[L] = W[(a+2)&3], (*D)[L] = W[(a+3)&3];
+        f(nl, t, B); f(nl, u, D);
+        bits(nl, ku, u, 0); bits(nl, kt, t, 0);
+        eor(nl, A, A, t); rotv(nl, A, ku); addk(nl, A, S, 2*i);
+        eor(nl, C, C, u); rotv(nl, C, kt); addk(nl, C, S, 2*i+1);
+    }
+    addk(nl, W[a], S, 2*r+2); addk(nl, W[(a+2)&3], S, 2*r+3);
+    xpose_store(x, out, rowp(rows, W, a, 4));
+}
+
+static void rc6_dec(const xpose *x, const uint64_t *S, int nl, int r,
+                    const unsigned char *in, unsigned char *out) {
+    word W[4], t, u;
+    uint32_t kt[L], ku[L], *rows[4];
+    int i, a = r&3;
+    xpose_load(x, in, rowp(rows, W, a, 4));
+    subk(nl, W[a], S, 2*r+2); subk(nl, W[(a+2)&3], S, 2*r+3);
+    for (i=r; i>=1; i--) {
+        uint32_t (*A)[L], (*B)[L], (*C)[L], (*D)[L];
+        a = (a+3)&3;
+        A = W[a]; B = W[(a+1)&3]; C = W[(a+2)&3]; D = W[(a+3)&3];
+        f(nl, t, B); f(nl, u, D);
+        bits(nl, kt, t, 1); bits(nl, ku, u, 1);
+        subk(nl, C, S, 2*i+1); rotv(nl, C, kt); eor(nl, C, C, u);
+        subk(nl, A, S, 2*i); rotv(nl, A, ku); eor(nl, A, A, t);
+    }
+    subk(nl, W[1], S, 0); subk(nl, W[3], S, 1);
+    xpose_store(x, out, rowp(rows, W, 0, 4));
+}
+
+static void rc5_enc(const xpose *x, const uint64_t *S, int nl, int r,
+                    const unsigned char *in, unsigned char *out) {
+    word W[2];
+    uint32_t (*A)[L] = W[0], (*B)[L] = W[1];
+    uint32_t k[L], *rows[2];
+    int i;
+    xpose_load(x, in, rowp(rows, W, 0, 2));
+    addk(nl, A, S, 0); addk(nl, B, S, 1);
+    for (i=1; i<=r; i++) {
+        eor(nl, A, A, B); bits(nl, k, B, 0); rotv(nl, A, k);
+        addk(nl, A, S, 2*i);
+        eor(nl, B, B, A); bits(nl, k, A, 0); rotv(nl, B, k);
+        addk(nl, B, S, 2*i+1);
+    }
+    xpose_store(x, out, rows);
+}
+
+static void rc5_dec(const xpose *x, const uint64_t *S, int nl, int r,
+                    const unsigned char *in, unsigned char *out) {
+    word W[2];
+    uint32_t (*A)[L] = W[0], (*B)[L] = W[1];
+    uint32_t k[L], *rows[2];
+    int i;
+    xpose_load(x, in, rowp(rows, W, 0, 2));
+    for (i=r; i>=1; i--) {
+        subk(nl, B, S, 2*i+1); bits(nl, k, A, 1); rotv(nl, B, k);
+        eor(nl, B, B, A);
+        subk(nl, A, S, 2*i); bits(nl, k, B, 1); rotv(nl, A, k);
+        eor(nl, A, A, B);
+    }
+    subk(nl, B, S, 1); subk(nl, A, S, 0);
+    xpose_store(x, out, rows);
+}
+
+/* Run fn over whole batches, then pad the tail into a full batch  */
+static void run(batch_fn fn, int words, void *rkey, int w, int r,
+                void *in, void *out, size_t nblocks) {
+    const unsigned char *p = (const unsigned char *)in;
+    unsigned char *q = (unsigned char *)out;
+    int nl = w/32;
+    size_t bpb = (size_t)words*w/8, len = nblocks*bpb;
+    xpose x;
+    PROBE4(bulk_entry, words == 4 ? "rc6v" : "rc5v", len, w, r);
+    xpose_init(&x, w, words, L);
+    for ( ; nblocks >= L; nblocks-=L, p+=L*bpb, q+=L*bpb)
+        fn(&x, (const uint64_t *)rkey, nl, r, p, q);
+    if (nblocks) {
+        unsigned char buf[L*4*NL*4];
+        memset(buf, 0, L*bpb);
+        memcpy(buf, p, nblocks*bpb);
+        fn(&x, (const uint64_t *)rkey, nl, r, buf, buf);
+        memcpy(q, buf, nblocks*bpb);
+    }
+    PROBE4(bulk_exit, words == 4 ? "rc6v" : "rc5v", len, w, r);
+}
+
+void rc6v_encrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks) {
+    run(rc6_enc, 4, rkey, w, r, in, out, nblocks);
+}
+void rc6v_decrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks) {
+    run(rc6_dec, 4, rkey, w, r, in, out, nblocks);
+}
+void rc5v_encrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks) {
+    run(rc5_enc, 2, rkey, w, r, in, out, nblocks);
+}
+void rc5v_decrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks) {
+    run(rc5_dec, 2, rkey, w, r, in, out, nblocks);
+}
+
+void blkcipher_rc6v(blkcipher *bc, void *rkey, int w, int r) {
+    bc->enc = rc6w_encrypt; bc->dec = rc6w_decrypt;
+    bc->encn = rc6v_encrypt; bc->decn = rc6v_decrypt;
+    bc->rkey = rkey; bc->w = w; bc->r = r; bc->bpb = w/2;
+    bc->lanes = RC6V_LANES;
+}
+
+void blkcipher_rc5v(blkcipher *bc, void *rkey, int w, int r) {
+    bc->enc = rc5w_encrypt; bc->dec = rc5w_decrypt;
+    bc->encn = rc5v_encrypt; bc->decn = rc5v_decrypt;
+    bc->rkey = rkey; bc->w = w; bc->r = r; bc->bpb = w/4;
+    bc->lanes = RC6V_LANES;
+}
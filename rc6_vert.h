@@ -0,0 +1,48 @@
+/*
+// Multi-block RC6 & RC5 for wide words, one block per vector lane.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* rc6_wide.c keeps a wide word in consecutive limbs, so every add,
+ * multiply and rotate is a carry or shift chain across the limbs of
+ * one block. Here RC6V_LANES blocks are enciphered together and
+ * limb i of a word is an array of that limb from every block
+ * (structure of arrays), so each step is the same scalar operation
+ * repeated across lanes, which compilers turn into vector code.
+ *
+ * w must be a multiple of 64 from 128 to 1024. The round keys are
+ * those of rc6w_setup/rc5w_setup and results match rc6_wide.c and
+ * rc6_ref.c. Any nblocks is accepted; a final partial batch is
+ * padded. Blocks move to and from lanes through transpose.c. The
+ * functions have the blkn_fn shape of modes.h.
+ */
+#ifndef RC6_VERT_H
+#define RC6_VERT_H
+
+#include <stddef.h>
+#include "modes.h"
+
+#define RC6V_LANES 32     /* Blocks per batch; see rc6_vert.c       */
+
+/* Nonzero iff rc6v_/rc5v_ functions accept this w                  */
+int rc6v_supported(int w);
+
+void rc6v_encrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks);
+void rc6v_decrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks);
+void rc5v_encrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks);
+void rc5v_decrypt(void *rkey, int w, int r, void *in, void *out,
+                  size_t nblocks);
+
+/* Like blkcipher_rc6/rc5 of modes.h, but over an rc6w/rc5w schedule
+ * with these functions as encn/decn, so ECB, CTR and CFB decryption
+ * run RC6V_LANES blocks at a time.
+ */
+void blkcipher_rc6v(blkcipher *bc, void *rkey, int w, int r);
+void blkcipher_rc5v(blkcipher *bc, void *rkey, int w, int r);
+
+#endif
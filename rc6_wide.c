@@ -0,0 +1,441 @@
+/*
+// RC6 & RC5 for any word size w that rc6_ref.c accepts, using 64-bit
+// limbs instead of bytes.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - At run-time: 8 <= w <= 1024, w%8==0, and both b and r in 0..255.
+ * - rkey aligned for uint64_t.
+ * - GCC extensions: unsigned __int128; on x86-64 also target
+ *   attributes and __builtin_cpu_supports for the IFMA multiplier.
+ *
+ * Arithmetic follows rc6_ref.c step for step, including rotation
+ * amounts taken from the low floor(lg w) bits for w not a power of 2.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "rc6_wide.h"
+#include "probes.h"
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(RC6W_NO_IFMA)
+#include <immintrin.h>
+#define HAVE_IFMA 1
+#endif
+
+typedef uint64_t limb;
+typedef unsigned __int128 dlimb;
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * C O N S T A N T   D A T A   &   U T I L I T Y   F U N C T I O N S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* 1024 bits of P_w/Q_w. For any w, grab w bits & set last bit 1.  */
+/* WolframAlpha: IntegerPart[(e - 2) * 2^1024] to hex              */
+static const unsigned char PP[] = {
+    0xb7,0xe1,0x51,0x62,0x8a,0xed,0x2a,0x6a,0xbf,0x71,0x58,0x80,0x9c,
+    0xf4,0xf3,0xc7,0x62,0xe7,0x16,0x0f,0x38,0xb4,0xda,0x56,0xa7,0x84,
+    0xd9,0x04,0x51,0x90,0xcf,0xef,0x32,0x4e,0x77,0x38,0x92,0x6c,0xfb,
+    0xe5,0xf4,0xbf,0x8d,0x8d,0x8c,0x31,0xd7,0x63,0xda,0x06,0xc8,0x0a,
+    0xbb,0x11,0x85,0xeb,0x4f,0x7c,0x7b,0x57,0x57,0xf5,0x95,0x84,0x90,
+    0xcf,0xd4,0x7d,0x7c,0x19,0xbb,0x42,0x15,0x8d,0x95,0x54,0xf7,0xb4,
+    0x6b,0xce,0xd5,0x5c,0x4d,0x79,0xfd,0x5f,0x24,0xd6,0x61,0x3c,0x31,
+    0xc3,0x83,0x9a,0x2d,0xdf,0x8a,0x9a,0x27,0x6b,0xcf,0xbf,0xa1,0xc8,
+    0x77,0xc5,0x62,0x84,0xda,0xb7,0x9c,0xd4,0xc2,0xb3,0x29,0x3d,0x20,
+    0xe9,0xe5,0xea,0xf0,0x2a,0xc6,0x0a,0xcc,0x93,0xed,0x87};
+/* WolframAlpha: IntegerPart[(GoldenRatio - 1) * 2^1024] to hex    */
+static const unsigned char QQ[] = {
+    0x9e,0x37,0x79,0xb9,0x7f,0x4a,0x7c,0x15,0xf3,0x9c,0xc0,0x60,0x5c,
+    0xed,0xc8,0x34,0x10,0x82,0x27,0x6b,0xf3,0xa2,0x72,0x51,0xf8,0x6c,
+    0x6a,0x11,0xd0,0xc1,0x8e,0x95,0x27,0x67,0xf0,0xb1,0x53,0xd2,0x7b,
+    0x7f,0x03,0x47,0x04,0x5b,0x5b,0xf1,0x82,0x7f,0x01,0x88,0x6f,0x09,
+    0x28,0x40,0x30,0x02,0xc1,0xd6,0x4b,0xa4,0x0f,0x33,0x5e,0x36,0xf0,
+    0x6a,0xd7,0xae,0x97,0x17,0x87,0x7e,0x85,0x83,0x9d,0x6e,0xff,0xbd,
+    0x7d,0xc6,0x64,0xd3,0x25,0xd1,0xc5,0x37,0x16,0x82,0xca,0xdd,0x0c,
+    0xcc,0xfd,0xff,0xbb,0xe1,0x62,0x6e,0x33,0xb8,0xd0,0x4b,0x43,0x31,
+    0xbb,0xf7,0x3c,0x79,0x0d,0x94,0xf7,0x9d,0x47,0x1c,0x4a,0xb3,0xed,
+    0x3d,0x82,0xa5,0xfe,0xc5,0x07,0x70,0x5e,0x4a,0xe6,0xe5};
+
+#define MAXL 16         /* Limbs in the largest word, w=1024        */
+
+/* Shape of a word: limb count, top-limb mask and floor(lg w), and
+ * whether f() should multiply with AVX-512 IFMA                   */
+typedef struct { int w, n, lgw, ifma; limb top; } shape;
+
+static int use_ifma(int w);
+
+static int mkshape(shape *s, int w) {
+    if (w<8 || w>1024 || w%8!=0) return -1;
+    s->w = w;
+    s->n = RC6W_LIMBS(w);
+    s->top = (w%64 ? ((limb)1 << w%64) - 1 : ~(limb)0);
+    for (s->lgw=0; (2<<s->lgw) <= w; s->lgw++) ;
+    s->ifma = use_ifma(w);
+    return 0;
+}
+
+/* z = x + y (mod 2^w)                                             */
+static void add(const shape *s, limb z[], const limb x[], const limb y[]) {
+    int i;
+    limb c = 0;
+    for (i=0; i<s->n; i++) {
+        limb t = x[i] + c;
+        c = (t < c);
+        z[i] = t + y[i];
+        c += (z[i] < t);
+    }
+    z[s->n-1] &= s->top;
+}
+
+/* z = x - y (mod 2^w)                                             */
+static void sub(const shape *s, limb z[], const limb x[], const limb y[]) {
+    int i;
+    limb b = 0;
+    for (i=0; i<s->n; i++) {
+        limb t = x[i] - y[i];
+        limb b2 = (x[i] < y[i]) | (t < b);
+        z[i] = t - b;
+        b = b2;
+    }
+    z[s->n-1] &= s->top;
+}
+
+/* z = x xor y                                                     */
+static void eor(const shape *s, limb z[], const limb x[], const limb y[]) {
+    int i;
+    for (i=0; i<s->n; i++) z[i] = x[i] ^ y[i];
+}
+
+/* z = x * y (mod 2^w), only the partial products below 2^w        */
+static void mul(const shape *s, limb z[], const limb x[], const limb y[]) {
+    limb t[MAXL] = {0};
+    int i, j, n = s->n;
+    for (i=0; i<n; i++) {
+        limb c = 0;
+        for (j=0; i+j<n; j++) {
+            dlimb p = (dlimb)x[i]*y[j] + t[i+j] + c;
+            t[i+j] = (limb)p;
+            c = (limb)(p >> 64);
+        }
+    }
+    t[n-1] &= s->top;
+    memcpy(z, t, n*sizeof(limb));
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * A V X - 5 1 2   I F M A   M U L T I P L I E R
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* For wide words the truncated product dominates a round. vpmadd52luq
+ * and vpmadd52huq give the low and high 52 bits of eight 52x52-bit
+ * products each, so operands are split into radix-2^52 digits and the
+ * schoolbook columns are summed eight at a time. Rotations and xors
+ * need radix 2^64, so digits are converted on entry and exit of each
+ * multiply rather than kept across the round. That conversion costs
+ * about as much as a 512-bit scalar product, so IFMA is only used
+ * from RC6W_IFMA_MIN_W up.                                        */
+
+#define D52 20          /* Digits in the largest word, ceil(1024/52) */
+#define M52 ((limb)0xfffffffffffff)
+#ifndef RC6W_IFMA_MIN_W
+#define RC6W_IFMA_MIN_W 576
+#endif
+
+#ifdef HAVE_IFMA
+static int use_ifma(int w) {
+    static int have = -1;               /* Benign race: same answer */
+    if (have < 0) have = __builtin_cpu_supports("avx512ifma") ? 1 : 0;
+    return have && w >= RC6W_IFMA_MIN_W;
+}
+
+/* Lane k of the digit split: bit 52k of x is bit sr[k] of limb q[k],
+ * and bits from limb q[k]+1 move up by sl[k]. Digits at or above
+ * 1024 bits shift by 64, which vpsrlvq/vpsllvq turn into zero.    */
+static const long long q52[24] = {
+    0, 0, 1, 2, 3, 4, 4, 5, 6, 7, 8, 8, 9,10,11,12,
+   13,13,14,15, 0, 1, 1, 2 };
+static const long long sr52[24] = {
+    0,52,40,28,16, 4,56,44,32,20, 8,60,48,36,24,12,
+    0,52,40,28,64,64,64,64 };
+static const long long sl52[24] = {
+   64,12,24,36,48,60, 8,20,32,44,56, 4,16,28,40,52,
+   64,12,24,64,64,64,64,64 };
+
+__attribute__((target("avx512f")))
+static void to52(limb d[24], const limb x[], int n) {
+    __mmask8 ma = (__mmask8)(n >= 8 ? 0xff : (1u << n) - 1);
+    __mmask8 mb = (__mmask8)(n <= 8 ? 0 : (1u << (n-8)) - 1);
+    __m512i xa = _mm512_maskz_loadu_epi64(ma, x);
+    __m512i xb = _mm512_maskz_loadu_epi64(mb, x+8);
+    __m512i m = _mm512_set1_epi64((long long)M52), one = _mm512_set1_epi64(1);
+    int v;
+    for (v=0; v<3; v++) {
+        __m512i q = _mm512_loadu_si512(q52 + 8*v);
+        __m512i lo = _mm512_permutex2var_epi64(xa, q, xb);
+        __m512i hi = _mm512_permutex2var_epi64(xa, _mm512_add_epi64(q, one), xb);
+        lo = _mm512_srlv_epi64(lo, _mm512_loadu_si512(sr52 + 8*v));
+        hi = _mm512_sllv_epi64(hi, _mm512_loadu_si512(sl52 + 8*v));
+        _mm512_storeu_si512(d + 8*v, _mm512_and_si512(_mm512_or_si512(lo, hi), m));
+    }
+}
+
+/* Inverse of to52 for digits below 2^52: limb 8h+j gathers digits
+ * p0..p0+2 of the window d[8h..8h+15], shifted by s0/s1/s2.       */
+static const long long p52[2][8] = {
+    { 0, 1, 2, 3, 4, 6, 7, 8 }, { 1, 3, 4, 5, 6, 8, 9,10 } };
+static const long long s52[2][3][8] = {
+    { { 0,12,24,36,48, 8,20,32 }, {52,40,28,16, 4,44,32,20 },
+      {64,64,64,64,56,64,64,64 } },
+    { {44, 4,16,28,40, 0,12,24 }, { 8,48,36,24,12,52,40,28 },
+      {60,64,64,64,64,64,64,64 } } };
+
+__attribute__((target("avx512f")))
+static void from52(limb z[16], const limb d[24]) {
+    __m512i one = _mm512_set1_epi64(1);
+    int h;
+    for (h=0; h<2; h++) {
+        __m512i da = _mm512_loadu_si512(d + 8*h);
+        __m512i db = _mm512_loadu_si512(d + 8*h + 8);
+        __m512i p = _mm512_loadu_si512(p52[h]), t;
+        t = _mm512_srlv_epi64(_mm512_permutex2var_epi64(da, p, db),
+                              _mm512_loadu_si512(s52[h][0]));
+        p = _mm512_add_epi64(p, one);
+        t = _mm512_or_si512(t, _mm512_sllv_epi64(
+                _mm512_permutex2var_epi64(da, p, db),
+                _mm512_loadu_si512(s52[h][1])));
+        p = _mm512_add_epi64(p, one);
+        t = _mm512_or_si512(t, _mm512_sllv_epi64(
+                _mm512_permutex2var_epi64(da, p, db),
+                _mm512_loadu_si512(s52[h][2])));
+        _mm512_storeu_si512(z + 8*h, t);
+    }
+}
+
+__attribute__((target("avx512f,avx512ifma")))
+static void mul_ifma(const shape *s, limb z[], const limb x[], const limb y[]) {
+    /* yp holds y's digits after D52 zeros, so loading at yp+D52-i
+     * gives y shifted up i columns with zeros shifted in.         */
+    limb xd[24], yp[D52+24], dl[24], dh[24], zl[16], zh[16];
+    __m512i mask = _mm512_set1_epi64((long long)M52), prev_hi, prev_c;
+    int i, v, n = s->n, nd = (s->w + 51)/52;
+    memset(yp, 0, D52*sizeof(limb));
+    to52(xd, x, n);
+    to52(yp+D52, y, n);
+    prev_hi = prev_c = _mm512_setzero_si512();
+    for (v=0; v<3; v++) {
+        __m512i lo0 = _mm512_setzero_si512(), hi0 = lo0, lo1 = lo0, hi1 = lo0;
+        __m512i col, hi;
+        /* Column k only takes x digits i <= k, so lanes 8v..8v+7
+         * stop at i = 8v+7; two accumulator pairs split the madd
+         * latency chain between even and odd i.                   */
+        int m = (nd < 8*v+8 ? nd : 8*v+8);
+        for (i=0; i<m; i+=2) {
+            __m512i x0 = _mm512_set1_epi64((long long)xd[i]);
+            __m512i x1 = _mm512_set1_epi64((long long)xd[i+1]);
+            __m512i y0 = _mm512_loadu_si512(yp + D52 - i + 8*v);
+            __m512i y1 = _mm512_loadu_si512(yp + D52 - i - 1 + 8*v);
+            lo0 = _mm512_madd52lo_epu64(lo0, x0, y0);
+            hi0 = _mm512_madd52hi_epu64(hi0, x0, y0);
+            lo1 = _mm512_madd52lo_epu64(lo1, x1, y1);
+            hi1 = _mm512_madd52hi_epu64(hi1, x1, y1);
+        }
+        /* Column k is lo[k] + hi[k-1], under 2^58. Rather than ripple
+         * carries through the digits, split each column into its low
+         * 52 bits and the excess, which belongs one column up; both
+         * halves are then well-formed radix-2^52 numbers.         */
+        hi = _mm512_add_epi64(hi0, hi1);
+        col = _mm512_add_epi64(_mm512_add_epi64(lo0, lo1),
+                               _mm512_alignr_epi64(hi, prev_hi, 7));
+        _mm512_storeu_si512(dl + 8*v, _mm512_and_si512(col, mask));
+        col = _mm512_srli_epi64(col, 52);
+        _mm512_storeu_si512(dh + 8*v, _mm512_alignr_epi64(col, prev_c, 7));
+        prev_hi = hi; prev_c = col;
+    }
+    /* Columns at or above nd only hold bits at or above 2^w, which
+     * the truncation below discards.                              */
+    from52(zl, dl);
+    from52(zh, dh);
+    add(s, z, zl, zh);
+}
+#else
+static int use_ifma(int w) { (void)w; return 0; }
+#endif
+
+/* z = x rotated left k bits, 0 <= k <= w                          */
+static void rotl(const shape *s, limb z[], const limb x[], int k) {
+    limb t[MAXL];
+    int i, n = s->n, q, b;
+    if (k == 0 || k == s->w) { memmove(z, x, n*sizeof(limb)); return; }
+    q = k/64; b = k%64;                 /* x << k                   */
+    for (i=0; i<n; i++) {
+        t[i] = (i-q >= 0 ? x[i-q] << b : 0);
+        if (b && i-q-1 >= 0) t[i] |= x[i-q-1] >> (64-b);
+    }
+    k = s->w - k;                       /* | x >> (w-k)             */
+    q = k/64; b = k%64;
+    for (i=0; i<n; i++) {
+        if (i+q < n) t[i] |= x[i+q] >> b;
+        if (b && i+q+1 < n) t[i] |= x[i+q+1] << (64-b);
+    }
+    t[n-1] &= s->top;
+    memcpy(z, t, n*sizeof(limb));
+}
+
+/* Low floor(lg w) bits of x, used as a rotation amount            */
+static int bits(const shape *s, const limb x[]) {
+    return (int)(x[0] & (((limb)1 << s->lgw) - 1));
+}
+
+/* Little-endian bytes p[0..w/8-1] to and from a word              */
+static void load(const shape *s, limb z[], const unsigned char *p) {
+    int i;
+    memset(z, 0, s->n*sizeof(limb));
+    for (i=0; i<s->w/8; i++) z[i/8] |= (limb)p[i] << 8*(i%8);
+}
+static void store(const shape *s, unsigned char *p, const limb x[]) {
+    int i;
+    for (i=0; i<s->w/8; i++) p[i] = (unsigned char)(x[i/8] >> 8*(i%8));
+}
+
+/* Top w bits of a 1024-bit big-endian constant, made odd          */
+static void constant(const shape *s, limb z[], const unsigned char c[]) {
+    int i, nb = s->w/8;
+    memset(z, 0, s->n*sizeof(limb));
+    for (i=0; i<nb; i++) z[i/8] |= (limb)c[nb-1-i] << 8*(i%8);
+    z[0] |= 1;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * A R C 6   A N D   A R C 5   F U N C T I O N S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+static int setup(void *rkey, int rk_words, int w, int r, int b, void *key) {
+    shape s;
+    if (mkshape(&s, w) || r<0 || r>255 || b<0 || b>255)
+        return -1;
+    else {
+        limb L[256], A[MAXL] = {0}, B[MAXL] = {0}, Q[MAXL], T[MAXL];
+        limb *S = (limb *)rkey;
+        int i, n = s.n, nb = w/8, mix_steps;
+        int l_words = (b==0 ? 1 : (b+nb-1)/nb);
+        /* The choice depends only on w and the CPU, so it is reported
+         * once per schedule rather than on every block            */
+        PROBE3(dispatch, "rc6w.ifma", s.ifma, w);
+        /* Fill S with constants                                   */
+        constant(&s, S, PP);
+        constant(&s, Q, QQ);
+        for (i=1; i<rk_words; i++) add(&s, S+i*n, S+(i-1)*n, Q);
+        /* Convert key bytes to little-endian key words            */
+        memset(L, 0, sizeof(L));
+        for (i=0; i<b; i++)
+            L[i/nb*n + i%nb/8] |= (limb)((unsigned char *)key)[i] << 8*(i%nb%8);
+        /* Mix key into S                                          */
+        mix_steps = 3 * (rk_words>l_words ? rk_words : l_words);
+        for (i=0; i<mix_steps; i++) {
+            limb *Si = S + i%rk_words*n, *Lj = L + i%l_words*n;
+            add(&s, A, A, B); add(&s, A, A, Si); rotl(&s, A, A, 3);
+            memcpy(Si, A, n*sizeof(limb));
+            add(&s, B, B, A); add(&s, T, B, Lj);
+            rotl(&s, B, T, bits(&s, B));
+            memcpy(Lj, B, n*sizeof(limb));
+        }
+        return 0;
+    }
+}
+int rc5w_setup(void *rkey, int w, int r, int b, void *key) {
+    int ret = setup(rkey, 2*r+2, w, r, b, key);
+    PROBE5(setup, 5, w, r, b, ret);
+    return ret;
+}
+int rc6w_setup(void *rkey, int w, int r, int b, void *key) {
+    int ret = setup(rkey, 2*r+4, w, r, b, key);
+    PROBE5(setup, 6, w, r, b, ret);
+    return ret;
+}
+
+void rc5w_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
+    shape s;
+    limb A[MAXL], B[MAXL], *S = (limb *)rkey;
+    unsigned char *p = (unsigned char *)pt, *c = (unsigned char *)ct;
+    int i, n;
+    mkshape(&s, w); n = s.n;
+    load(&s, A, p); load(&s, B, p+w/8);
+    add(&s, A, A, S); add(&s, B, B, S+n);
+    for (i=1; i<=r; i++) {
+        eor(&s, A, A, B); rotl(&s, A, A, bits(&s, B));
+        add(&s, A, A, S+2*i*n);
+        eor(&s, B, B, A); rotl(&s, B, B, bits(&s, A));
+        add(&s, B, B, S+(2*i+1)*n);
+    }
+    store(&s, c, A); store(&s, c+w/8, B);
+}
+
+void rc5w_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
+    shape s;
+    limb A[MAXL], B[MAXL], *S = (limb *)rkey;
+    unsigned char *p = (unsigned char *)pt, *c = (unsigned char *)ct;
+    int i, n;
+    mkshape(&s, w); n = s.n;
+    load(&s, A, c); load(&s, B, c+w/8);
+    for (i=r; i>0; i--) {
+        sub(&s, B, B, S+(2*i+1)*n); rotl(&s, B, B, w-bits(&s, A));
+        eor(&s, B, B, A);
+        sub(&s, A, A, S+2*i*n); rotl(&s, A, A, w-bits(&s, B));
+        eor(&s, A, A, B);
+    }
+    sub(&s, B, B, S+n); sub(&s, A, A, S);
+    store(&s, p, A); store(&s, p+w/8, B);
+}
+
+/* f(x) = rotl(x*(2x+1), lg w)                                     */
+static void f(const shape *s, limb z[], const limb x[]) {
+    limb t[MAXL];
+    rotl(s, t, x, 1); t[0] |= 1;        /* t = 2x+1 (mod 2^w)       */
+#ifdef HAVE_IFMA
+    if (s->ifma) mul_ifma(s, t, t, x);
+    else
+#endif
+    mul(s, t, t, x);
+    rotl(s, z, t, s->lgw);
+}
+
+void rc6w_encrypt(void *rkey, int w, int r, void *pt, void *ct) {
+    shape s;
+    limb W[4][MAXL], t[MAXL], u[MAXL], *S = (limb *)rkey;
+    limb *A = W[0], *B = W[1], *C = W[2], *D = W[3], *x;
+    unsigned char *p = (unsigned char *)pt, *c = (unsigned char *)ct;
+    int i, n, nb = w/8;
+    mkshape(&s, w); n = s.n;
+    load(&s, A, p); load(&s, B, p+nb); load(&s, C, p+2*nb); load(&s, D, p+3*nb);
+    add(&s, B, B, S); add(&s, D, D, S+n);
+    for (i=1; i<=r; i++) {
+        f(&s, t, B); f(&s, u, D);
+        eor(&s, A, A, t); rotl(&s, A, A, bits(&s, u)); add(&s, A, A, S+2*i*n);
+        eor(&s, C, C, u); rotl(&s, C, C, bits(&s, t)); add(&s, C, C, S+(2*i+1)*n);
+        x = A; A = B; B = C; C = D; D = x;
+    }
+    add(&s, A, A, S+(2*r+2)*n); add(&s, C, C, S+(2*r+3)*n);
+    store(&s, c, A); store(&s, c+nb, B); store(&s, c+2*nb, C); store(&s, c+3*nb, D);
+}
+
+void rc6w_decrypt(void *rkey, int w, int r, void *ct, void *pt) {
+    shape s;
+    limb W[4][MAXL], t[MAXL], u[MAXL], *S = (limb *)rkey;
+    limb *A = W[0], *B = W[1], *C = W[2], *D = W[3], *x;
+    unsigned char *p = (unsigned char *)pt, *c = (unsigned char *)ct;
+    int i, n, nb = w/8;
+    mkshape(&s, w); n = s.n;
+    load(&s, A, c); load(&s, B, c+nb); load(&s, C, c+2*nb); load(&s, D, c+3*nb);
+    sub(&s, A, A, S+(2*r+2)*n); sub(&s, C, C, S+(2*r+3)*n);
+    for (i=r; i>=1; i--) {
+        x = D; D = C; C = B; B = A; A = x;
+        f(&s, t, B); f(&s, u, D);
+        sub(&s, C, C, S+(2*i+1)*n); rotl(&s, C, C, w-bits(&s, t)); eor(&s, C, C, u);
+        sub(&s, A, A, S+2*i*n); rotl(&s, A, A, w-bits(&s, u)); eor(&s, A, A, t);
+    }
+    sub(&s, B, B, S); sub(&s, D, D, S+n);
+    store(&s, p, A); store(&s, p+nb, B); store(&s, p+2*nb, C); store(&s, p+3*nb, D);
+}
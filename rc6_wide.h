@@ -0,0 +1,36 @@
+/*
+// RC6 & RC5 for any word size w that rc6_ref.c accepts, using 64-bit
+// limbs instead of bytes.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* These compute exactly what rc6_ref.c computes for 8 <= w <= 1024,
+ * w%8==0, any r in 0..255 and b in 0..255, with the same byte order
+ * for keys and blocks, but hold each word in (w+63)/64 little-endian
+ * uint64_t limbs. Names carry a "w" so they can be linked alongside
+ * rc6.c, whose word size is fixed at compile time. rkey must be
+ * aligned for uint64_t; key, pt and ct need no alignment.
+ *
+ * On x86-64 CPUs with AVX-512 IFMA, RC6 words of RC6W_IFMA_MIN_W
+ * bits or more are multiplied with vpmadd52; build with
+ * -DRC6W_NO_IFMA to leave that path out.
+ */
+#ifndef RC6_WIDE_H
+#define RC6_WIDE_H
+
+#define RC6W_LIMBS(w)       (((w)+63)/64)
+#define RC6W_RKEY_BYTES(w,r) (8*RC6W_LIMBS(w)*(2*(r)+4))
+#define RC5W_RKEY_BYTES(w,r) (8*RC6W_LIMBS(w)*(2*(r)+2))
+
+/* Both return 0 iff w/r/b are supported and rkey is filled.       */
+int rc6w_setup(void *rkey, int w, int r, int b, void *key);
+void rc6w_encrypt(void *rkey, int w, int r, void *pt, void *ct);
+void rc6w_decrypt(void *rkey, int w, int r, void *ct, void *pt);
+
+int rc5w_setup(void *rkey, int w, int r, int b, void *key);
+void rc5w_encrypt(void *rkey, int w, int r, void *pt, void *ct);
+void rc5w_decrypt(void *rkey, int w, int r, void *ct, void *pt);
+
+#endif
@@ -0,0 +1,409 @@
+/*
+// SQLite VFS shim encrypting database pages with wide-block RC6.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - SQLite 3.7.0 or later (sqlite3.h, link with -lsqlite3).
+ * - rc6_wide.c, rc6_vert.c with transpose.c, and modes.c (which
+ *   needs an rc6.h implementation to link).
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sqlite3.h>
+#include "modes.h"
+#include "rc6_wide.h"
+#include "rc6_vert.h"
+#include "sqlite_vfs.h"
+
+#define WAL_HDR   32        /* WAL file header bytes                 */
+#define FRAME_HDR 24        /* WAL frame header bytes                */
+#define FRAME_SALT 8        /* Offset of the salts in a frame header */
+#define FRAME_CKS 16        /* Offset of the checksums               */
+
+enum { KIND_PLAIN, KIND_MAIN, KIND_WAL };
+
+/* First byte of every block enciphered to derive a mask or key    */
+enum { DOM_PAGE = 1, DOM_INDEX, DOM_CKS, DOM_CKSKEY };
+
+typedef struct {
+    sqlite3_vfs base;
+    sqlite3_vfs *parent;
+    blkcipher bc;           /* rc6w schedule, rc6v kernels if useful */
+    uint64_t *rk16;         /* RC6-16 schedule for frame checksums   */
+    unsigned char *kidx;    /* Mask of each block index of a page   */
+    int page_size;
+} rc6vfs;
+
+typedef struct {
+    sqlite3_file base;
+    rc6vfs *vfs;
+    int kind;
+    unsigned char *page;    /* Scratch for one page                  */
+    sqlite3_file *real;     /* Parent's file, allocated just after us */
+} rc6file;
+
+typedef union {
+    unsigned char b[BLK_MAX]; unsigned long long a; long double d;
+} blkbuf;
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * P A G E   E N C R Y P T I O N
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Encipher the block dom, kind, salt (8 bytes, zeros if NULL), num
+ * (8 bytes little-endian), zeros, to b                            */
+static void derive(const rc6vfs *v, unsigned char *b, int dom, int kind,
+                   const unsigned char *salt, sqlite3_int64 num) {
+    int i;
+    memset(b, 0, v->bc.bpb);
+    b[0] = (unsigned char)dom;
+    b[1] = (unsigned char)kind;
+    if (salt) memcpy(b+2, salt, 8);
+    for (i=0; i<8; i++) b[10+i] = (unsigned char)(num >> 8*i);
+    v->bc.enc(v->bc.rkey, v->bc.w, v->bc.r, b, b);
+}
+
+/* Encrypt (dir=1) or decrypt (dir=0) page p in place. Block j of the
+ * page is enciphered as E(P xor D) xor D, with D the page mask (the
+ * encryption of kind, salt and num) xor the mask of index j, so the
+ * page's blocks go to ecb together. num is the page number for
+ * databases and the frame index for WALs, salt the frame's salts.  */
+static void page_crypt(const rc6vfs *v, int dir, int kind,
+                       const unsigned char *salt, sqlite3_int64 num,
+                       unsigned char *p) {
+    blkbuf m;
+    int i, j, n = v->bc.bpb, ps = v->page_size;
+    derive(v, m.b, DOM_PAGE, kind, salt, num);
+    for (j=0; j<ps; j+=n)
+        for (i=0; i<n; i++) p[j+i] ^= m.b[i] ^ v->kidx[j+i];
+    if (dir) ecb_encrypt(&v->bc, p, p, ps);
+    else     ecb_decrypt(&v->bc, p, p, ps);
+    for (j=0; j<ps; j+=n)
+        for (i=0; i<n; i++) p[j+i] ^= m.b[i] ^ v->kidx[j+i];
+    memset(m.b, 0, n);
+}
+
+/* The two checksums of WAL frame k are one RC6-16 block, enciphered
+ * with a mask derived from salt and k like a page's              */
+static void cks_crypt(const rc6vfs *v, int dir, const unsigned char *salt,
+                      sqlite3_int64 k, unsigned char *c) {
+    blkbuf m;
+    unsigned char x[8];
+    int i;
+    derive(v, m.b, DOM_CKS, KIND_WAL, salt, k);
+    for (i=0; i<8; i++) x[i] = c[i] ^ m.b[i];
+    if (dir) rc6w_encrypt(v->rk16, 16, v->bc.r, x, x);
+    else     rc6w_decrypt(v->rk16, 16, v->bc.r, x, x);
+    for (i=0; i<8; i++) c[i] = x[i] ^ m.b[i];
+    memset(m.b, 0, v->bc.bpb);
+}
+
+/* Salts of the WAL frame at fs: from buf when it holds them, else
+ * from the frame header already on disk. Returns nonzero on error. */
+static int frame_salt(rc6file *f, const unsigned char *buf,
+                      sqlite3_int64 ofst, sqlite3_int64 end,
+                      sqlite3_int64 fs, unsigned char salt[8]) {
+    sqlite3_int64 s = fs + FRAME_SALT;
+    if (s >= ofst && s + 8 <= end) {
+        memcpy(salt, buf + (s - ofst), 8);
+        return 0;
+    }
+    return f->real->pMethods->xRead(f->real, salt, 8, s) != SQLITE_OK;
+}
+
+/* Encrypt or decrypt each page, WAL frame and frame checksum pair
+ * held in buf, which was read from or is going to ofst. Returns
+ * nonzero if one lies only partly inside buf, which this shim cannot
+ * handle, or a frame's salts cannot be read.                       */
+static int crypt_range(rc6file *f, int dir, unsigned char *buf,
+                       int amt, sqlite3_int64 ofst) {
+    const rc6vfs *v = f->vfs;
+    sqlite3_int64 ps = v->page_size, k, end = ofst + amt, fs;
+    unsigned char salt[8];
+    if (f->kind == KIND_MAIN) {
+        if (ofst % ps || amt % ps) return 1;
+        for (k=ofst/ps; k*ps<end; k++)
+            page_crypt(v, dir, KIND_MAIN, NULL, k+1, buf + (k*ps - ofst));
+    } else if (f->kind == KIND_WAL && end > WAL_HDR) {
+        k = (ofst > WAL_HDR ? (ofst - WAL_HDR) / (FRAME_HDR+ps) : 0);
+        for ( ; (fs = WAL_HDR + k*(FRAME_HDR+ps)) < end; k++) {
+            sqlite3_int64 ck = fs + FRAME_CKS, co = fs + FRAME_HDR;
+            int has_ck = (ck < end && ck + 8 > ofst);
+            int has_co = (co < end && co + ps > ofst);
+            if (!has_ck && !has_co) continue;
+            if ((has_ck && (ck < ofst || ck + 8 > end)) ||
+                (has_co && (co < ofst || co + ps > end)) ||
+                frame_salt(f, buf, ofst, end, fs, salt))
+                return 1;
+            if (has_ck) cks_crypt(v, dir, salt, k, buf + (ck - ofst));
+            if (has_co)
+                page_crypt(v, dir, KIND_WAL, salt, k, buf + (co - ofst));
+        }
+    }
+    return 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * F I L E   M E T H O D S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+static int fClose(sqlite3_file *pf) {
+    rc6file *f = (rc6file *)pf;
+    int rc = f->real->pMethods ? f->real->pMethods->xClose(f->real)
+                               : SQLITE_OK;
+    sqlite3_free(f->page);
+    return rc;
+}
+
+static int fRead(sqlite3_file *pf, void *buf, int amt, sqlite3_int64 ofst) {
+    rc6file *f = (rc6file *)pf;
+    sqlite3_file *real = f->real;
+    sqlite3_int64 ps = f->vfs->page_size, pg = ofst / ps * ps;
+    int rc;
+    if (f->kind == KIND_MAIN && (ofst % ps || amt % ps)) {
+        /* Sub-page read (eg, the 100-byte header): go via scratch  */
+        if (ofst + amt > pg + ps) return SQLITE_IOERR_READ;
+        rc = real->pMethods->xRead(real, f->page, (int)ps, pg);
+        if (rc == SQLITE_OK) {
+            page_crypt(f->vfs, 0, KIND_MAIN, NULL, pg/ps + 1, f->page);
+            memcpy(buf, f->page + (ofst - pg), amt);
+        } else if (rc == SQLITE_IOERR_SHORT_READ) {
+            memset(buf, 0, amt);
+        }
+        return rc;
+    }
+    rc = real->pMethods->xRead(real, buf, amt, ofst);
+    if (rc == SQLITE_IOERR_SHORT_READ && f->kind == KIND_MAIN) {
+        /* Decrypt the whole pages present; the rest reads as zero  */
+        sqlite3_int64 sz = 0;
+        int have;
+        real->pMethods->xFileSize(real, &sz);
+        have = (sz > ofst ? (int)((sz - ofst) / ps * ps) : 0);
+        if (have > amt) have = amt;
+        memset((char *)buf + have, 0, amt - have);
+        crypt_range(f, 0, (unsigned char *)buf, have, ofst);
+    } else if (rc == SQLITE_OK) {
+        if (crypt_range(f, 0, (unsigned char *)buf, amt, ofst))
+            return SQLITE_IOERR_READ;
+    }
+    return rc;
+}
+
+static int fWrite(sqlite3_file *pf, const void *buf, int amt,
+                  sqlite3_int64 ofst) {
+    rc6file *f = (rc6file *)pf;
+    sqlite3_file *real = f->real;
+    unsigned char *tmp = f->page;
+    int rc;
+    if (f->kind == KIND_PLAIN)
+        return real->pMethods->xWrite(real, buf, amt, ofst);
+    /* Encrypt a copy so the caller's buffer is left as it was      */
+    if (amt > f->vfs->page_size &&
+        (tmp = (unsigned char *)sqlite3_malloc(amt)) == NULL)
+        return SQLITE_IOERR_NOMEM;
+    memcpy(tmp, buf, amt);
+    if (crypt_range(f, 1, tmp, amt, ofst)) rc = SQLITE_IOERR_WRITE;
+    else rc = real->pMethods->xWrite(real, tmp, amt, ofst);
+    if (tmp != f->page) sqlite3_free(tmp);
+    return rc;
+}
+
+/* The remaining file methods are forwarded to the parent's file   */
+#define REAL(pf) (((rc6file *)(pf))->real)
+
+static int fTruncate(sqlite3_file *pf, sqlite3_int64 size) {
+    return REAL(pf)->pMethods->xTruncate(REAL(pf), size);
+}
+static int fSync(sqlite3_file *pf, int flags) {
+    return REAL(pf)->pMethods->xSync(REAL(pf), flags);
+}
+static int fFileSize(sqlite3_file *pf, sqlite3_int64 *size) {
+    return REAL(pf)->pMethods->xFileSize(REAL(pf), size);
+}
+static int fLock(sqlite3_file *pf, int lock) {
+    return REAL(pf)->pMethods->xLock(REAL(pf), lock);
+}
+static int fUnlock(sqlite3_file *pf, int lock) {
+    return REAL(pf)->pMethods->xUnlock(REAL(pf), lock);
+}
+static int fCheckReservedLock(sqlite3_file *pf, int *out) {
+    return REAL(pf)->pMethods->xCheckReservedLock(REAL(pf), out);
+}
+static int fFileControl(sqlite3_file *pf, int op, void *arg) {
+    return REAL(pf)->pMethods->xFileControl(REAL(pf), op, arg);
+}
+static int fSectorSize(sqlite3_file *pf) {
+    return REAL(pf)->pMethods->xSectorSize(REAL(pf));
+}
+static int fDeviceCharacteristics(sqlite3_file *pf) {
+    return REAL(pf)->pMethods->xDeviceCharacteristics(REAL(pf));
+}
+static int fShmMap(sqlite3_file *pf, int pg, int sz, int extend,
+                   void volatile **pp) {
+    return REAL(pf)->pMethods->xShmMap(REAL(pf), pg, sz, extend, pp);
+}
+static int fShmLock(sqlite3_file *pf, int offset, int n, int flags) {
+    return REAL(pf)->pMethods->xShmLock(REAL(pf), offset, n, flags);
+}
+static void fShmBarrier(sqlite3_file *pf) {
+    REAL(pf)->pMethods->xShmBarrier(REAL(pf));
+}
+static int fShmUnmap(sqlite3_file *pf, int del) {
+    return REAL(pf)->pMethods->xShmUnmap(REAL(pf), del);
+}
+
+/* Version 2: shared memory for WAL, but no xFetch (mmap) methods   */
+static const sqlite3_io_methods io_methods = {
+    2, fClose, fRead, fWrite, fTruncate, fSync, fFileSize, fLock,
+    fUnlock, fCheckReservedLock, fFileControl, fSectorSize,
+    fDeviceCharacteristics, fShmMap, fShmLock, fShmBarrier, fShmUnmap,
+    0, 0
+};
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * V F S   M E T H O D S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#define PARENT(pv) (((rc6vfs *)(pv))->parent)
+
+static int vOpen(sqlite3_vfs *pv, const char *name, sqlite3_file *pf,
+                 int flags, int *out_flags) {
+    rc6vfs *v = (rc6vfs *)pv;
+    rc6file *f = (rc6file *)pf;
+    int rc;
+    memset(f, 0, sizeof(*f));
+    /* Rollback and statement journals, temp databases and sorter
+     * spill files carry page images or rows that would reach disk in
+     * plaintext, so they are refused, not passed through. The super-
+     * journal holds only journal file names.                       */
+    if (!(flags & (SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_WAL |
+                   SQLITE_OPEN_MASTER_JOURNAL)))
+        return SQLITE_CANTOPEN;
+    f->vfs = v;
+    f->real = (sqlite3_file *)(f + 1);
+    f->kind = (flags & SQLITE_OPEN_MAIN_DB) ? KIND_MAIN :
+              (flags & SQLITE_OPEN_WAL) ? KIND_WAL : KIND_PLAIN;
+    if (f->kind != KIND_PLAIN &&
+        (f->page = (unsigned char *)sqlite3_malloc(v->page_size)) == NULL)
+        return SQLITE_NOMEM;
+    rc = v->parent->xOpen(v->parent, name, f->real, flags, out_flags);
+    /* pMethods must be set even on failure, so xClose gets called  */
+    pf->pMethods = &io_methods;
+    return rc;
+}
+static int vDelete(sqlite3_vfs *pv, const char *name, int sync) {
+    return PARENT(pv)->xDelete(PARENT(pv), name, sync);
+}
+static int vAccess(sqlite3_vfs *pv, const char *name, int flags, int *out) {
+    return PARENT(pv)->xAccess(PARENT(pv), name, flags, out);
+}
+static int vFullPathname(sqlite3_vfs *pv, const char *name, int n,
+                         char *out) {
+    return PARENT(pv)->xFullPathname(PARENT(pv), name, n, out);
+}
+static void *vDlOpen(sqlite3_vfs *pv, const char *name) {
+    return PARENT(pv)->xDlOpen(PARENT(pv), name);
+}
+static void vDlError(sqlite3_vfs *pv, int n, char *msg) {
+    PARENT(pv)->xDlError(PARENT(pv), n, msg);
+}
+static void (*vDlSym(sqlite3_vfs *pv, void *h, const char *sym))(void) {
+    return PARENT(pv)->xDlSym(PARENT(pv), h, sym);
+}
+static void vDlClose(sqlite3_vfs *pv, void *h) {
+    PARENT(pv)->xDlClose(PARENT(pv), h);
+}
+static int vRandomness(sqlite3_vfs *pv, int n, char *out) {
+    return PARENT(pv)->xRandomness(PARENT(pv), n, out);
+}
+static int vSleep(sqlite3_vfs *pv, int us) {
+    return PARENT(pv)->xSleep(PARENT(pv), us);
+}
+static int vCurrentTime(sqlite3_vfs *pv, double *t) {
+    return PARENT(pv)->xCurrentTime(PARENT(pv), t);
+}
+static int vGetLastError(sqlite3_vfs *pv, int n, char *msg) {
+    return PARENT(pv)->xGetLastError ?
+           PARENT(pv)->xGetLastError(PARENT(pv), n, msg) : 0;
+}
+static int vCurrentTimeInt64(sqlite3_vfs *pv, sqlite3_int64 *t) {
+    return PARENT(pv)->xCurrentTimeInt64(PARENT(pv), t);
+}
+
+int rc6vfs_register(const char *name, const char *parent,
+                    int w, int r, const void *key, int keylen,
+                    int page_size, int make_default) {
+    sqlite3_vfs *pp = sqlite3_vfs_find(parent);
+    size_t rksz = RC6W_RKEY_BYTES(w, r), r16sz = RC6W_RKEY_BYTES(16, r);
+    size_t keys_sz = rksz + r16sz + (size_t)page_size;
+    rc6vfs *v;
+    unsigned char *keys;
+    blkbuf k16;
+    int rc, j, n = w/2;
+    if (pp == NULL)
+        return SQLITE_ERROR;
+    if (w < 64 || w > 1024 || w % 8 || r < 0 || r > 255 ||
+        page_size <= 0 || page_size % n)
+        return SQLITE_MISUSE;
+    v = (rc6vfs *)calloc(1, sizeof(rc6vfs) + strlen(name) + 1);
+    keys = (unsigned char *)malloc(keys_sz);
+    if (v == NULL || keys == NULL) {
+        free(v); free(keys);
+        return SQLITE_NOMEM;
+    }
+    if (rc6w_setup(keys, w, r, keylen, (void *)key)) {
+        memset(keys, 0, keys_sz);
+        free(v); free(keys);
+        return SQLITE_MISUSE;
+    }
+    /* rc6v pads a short batch to RC6V_LANES blocks, so pages of fewer
+     * blocks than that are faster one rc6w block at a time         */
+    blkcipher_rc6v(&v->bc, keys, w, r);
+    if (!rc6v_supported(w) || page_size/n < RC6V_LANES) {
+        v->bc.encn = v->bc.decn = NULL;
+        v->bc.lanes = 0;
+    }
+    v->rk16 = (uint64_t *)(keys + rksz);
+    v->kidx = keys + rksz + r16sz;
+    v->page_size = page_size;
+    derive(v, k16.b, DOM_CKSKEY, 0, NULL, 0);
+    rc6w_setup(v->rk16, 16, r, 16, k16.b);
+    memset(k16.b, 0, n);
+    for (j=0; j<page_size/n; j++) {
+        memset(v->kidx + j*n, 0, n);
+        v->kidx[j*n] = DOM_INDEX;
+        v->kidx[j*n+1] = (unsigned char)j;
+        v->kidx[j*n+2] = (unsigned char)(j >> 8);
+        v->kidx[j*n+3] = (unsigned char)(j >> 16);
+    }
+    ecb_encrypt(&v->bc, v->kidx, v->kidx, page_size);
+    v->parent = pp;
+    v->base.iVersion = 2;
+    v->base.szOsFile = (int)sizeof(rc6file) + pp->szOsFile;
+    v->base.mxPathname = pp->mxPathname;
+    v->base.zName = strcpy((char *)(v + 1), name);
+    v->base.xOpen = vOpen;
+    v->base.xDelete = vDelete;
+    v->base.xAccess = vAccess;
+    v->base.xFullPathname = vFullPathname;
+    v->base.xDlOpen = vDlOpen;
+    v->base.xDlError = vDlError;
+    v->base.xDlSym = vDlSym;
+    v->base.xDlClose = vDlClose;
+    v->base.xRandomness = vRandomness;
+    v->base.xSleep = vSleep;
+    v->base.xCurrentTime = vCurrentTime;
+    v->base.xGetLastError = vGetLastError;
+    v->base.xCurrentTimeInt64 = (pp->iVersion >= 2 && pp->xCurrentTimeInt64)
+                                ? vCurrentTimeInt64 : 0;
+    if ((rc = sqlite3_vfs_register(&v->base, make_default)) != SQLITE_OK) {
+        memset(keys, 0, keys_sz);
+        free(v); free(keys);
+    }
+    return rc;
+}
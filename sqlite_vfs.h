@@ -0,0 +1,55 @@
+/*
+// SQLite VFS shim encrypting database pages with wide-block RC6.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+#ifndef SQLITE_VFS_H
+#define SQLITE_VFS_H
+
+/* Each page is cut into blocks of w/2 bytes, and block j is
+ * enciphered as E(P xor D) xor D with wide-block RC6 (rc6_wide.h),
+ * where D is the encryption of the page's tweak xor a per-key mask
+ * of j. The tweak of a database page is its page number; that of a
+ * WAL frame's page is the frame index and the frame's two salts, so
+ * a page rewritten in a later WAL generation encrypts differently.
+ * A page costs page_size/(w/2) block calls plus one, run through the
+ * rc6_vert.c kernels when the page holds at least RC6V_LANES blocks:
+ * at w=1024 a 4 KiB page is 9 calls of rc6w.
+ *
+ * The checksums in each WAL frame header are enciphered as one
+ * RC6-16 block under the same tweak, since over plaintext they would
+ * tell an attacker about the page. Finding a frame's salts takes an
+ * extra 8-byte read of its header when SQLite reads or writes the
+ * page alone. The page number, commit size and salts stay in the
+ * clear, as do the WAL header and its checksums, which cover only
+ * the header. Blocks are enciphered on their own, so an attacker
+ * who sees a page before and after a rewrite under the same tweak
+ * learns which w/2-byte blocks changed.
+ *
+ * Main database files and WAL files are encrypted. Rollback and
+ * statement journals, temp databases and sorter spill files would
+ * hold plaintext, so opening them fails with SQLITE_CANTOPEN. Keep
+ * them off the VFS with PRAGMA temp_store=MEMORY on each connection
+ * and WAL mode; a new database reaches WAL through PRAGMA
+ * journal_mode=MEMORY then PRAGMA journal_mode=WAL, since the switch
+ * is itself a write.
+ *
+ * Every database opened through the VFS must have exactly page_size
+ * byte pages (set PRAGMA page_size before creating it), and
+ * page_size must be a multiple of the RC6 block size (w/2 bytes).
+ * Misaligned I/O, and I/O that cuts a frame's checksums, fails with
+ * SQLITE_IOERR.
+ * Memory-mapped I/O is not offered, since it would bypass decryption.
+ */
+
+/* Register a VFS called name that wraps the VFS named parent (NULL
+ * for the default). w must be a multiple of 8 from 64 to 1024.
+ * Returns SQLITE_OK, or an SQLite error code if w, r, keylen or
+ * page_size are unsupported.
+ */
+int rc6vfs_register(const char *name, const char *parent,
+                    int w, int r, const void *key, int keylen,
+                    int page_size, int make_default);
+
+#endif
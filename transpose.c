@@ -0,0 +1,186 @@
+/*
+// Block <-> lane transposition for multi-block RC6/RC5 kernels.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - On x86 with GCC or Clang, target attributes and
+ *   __builtin_cpu_supports select the SSSE3 path at xpose_init.
+ */
+
+#include <string.h>
+#include "transpose.h"
+#include "probes.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_SSSE3 1
+#endif
+
+int xpose_init(xpose *x, int w, int words, int lanes) {
+    int v, i, b, wb = w/8;
+    if (w<8 || w>1024 || w%8 || words<1 || words>4 || lanes<1)
+        return -1;
+    memset(x, 0, sizeof(*x));
+    x->w = w; x->words = words; x->lanes = lanes;
+    x->nl = (w+31)/32; x->bpb = words*wb;
+    for (v=0; v<words; v++)
+        for (i=0; i<x->nl; i++) {
+            int r = v*x->nl + i, len = wb - 4*i;
+            if (len > 4) len = 4;
+            x->row[r].off = (unsigned short)(v*wb + 4*i);
+            x->row[r].len = (unsigned char)len;
+            x->row[r].whole = (x->row[r].off + 4 <= x->bpb);
+            x->row[r].mask = (len == 4 ? 0xffffffffu : (1u << 8*len) - 1);
+        }
+    /* One 16-byte shuffle per block needs the block and its limbs to
+     * fit a vector, and whole groups of four lanes.               */
+    memset(x->ctl, 0x80, 16);
+    memset(x->ictl, 0x80, 16);
+    if (x->bpb <= 16 && words*x->nl <= 4 && lanes%4 == 0) {
+        for (v=0; v<words; v++)
+            for (i=0; i<x->nl; i++)
+                for (b=0; b<4 && 4*i+b < wb; b++) {
+                    int from = v*wb + 4*i + b, to = 4*(v*x->nl + i) + b;
+                    x->ctl[to] = (unsigned char)from;
+                    x->ictl[from] = (unsigned char)to;
+                }
+#ifdef HAVE_SSSE3
+        x->shuf = __builtin_cpu_supports("ssse3");
+#endif
+    }
+    PROBE3(dispatch, "xpose.ssse3", x->shuf, w);
+    return 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * T A B L E   P A T H
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Blocks are walked in order and each row's limb is loaded with
+ * one unaligned 32-bit read, masked to the word. A read may run into
+ * the next block, which only matters for the batch's last block; its
+ * limbs that would read past the end are built byte by byte.     */
+static uint32_t get32(const unsigned char *q) {
+    return (uint32_t)q[0] | (uint32_t)q[1] << 8 |
+           (uint32_t)q[2] << 16 | (uint32_t)q[3] << 24;
+}
+
+static void load_table(const xpose *x, const unsigned char *p,
+                       uint32_t *const rows[]) {
+    uint32_t *o[XP_ROWS];
+    int r, j, k, L = x->lanes, nr = x->words*x->nl;
+    for (r=0; r<nr; r++) o[r] = rows[r/x->nl] + r%x->nl*L;
+    for (j=0; j<L-1; j++, p+=x->bpb)
+        for (r=0; r<nr; r++)
+            o[r][j] = get32(p + x->row[r].off) & x->row[r].mask;
+    for (r=0; r<nr; r++) {
+        const unsigned char *q = p + x->row[r].off;
+        if (x->row[r].whole)
+            o[r][j] = get32(q) & x->row[r].mask;
+        else
+            for (o[r][j]=0, k=0; k<x->row[r].len; k++)
+                o[r][j] |= (uint32_t)q[k] << 8*k;
+    }
+}
+
+/* Stores write only the word's bytes of each limb                 */
+static void store_table(const xpose *x, unsigned char *p,
+                        uint32_t *const rows[]) {
+    const uint32_t *o[XP_ROWS];
+    int r, j, k, L = x->lanes, nr = x->words*x->nl;
+    for (r=0; r<nr; r++) o[r] = rows[r/x->nl] + r%x->nl*L;
+    for (j=0; j<L; j++, p+=x->bpb)
+        for (r=0; r<nr; r++) {
+            unsigned char *q = p + x->row[r].off;
+            uint32_t v = o[r][j];
+            if (x->row[r].len == 4) {
+                q[0] = (unsigned char)v; q[1] = (unsigned char)(v >> 8);
+                q[2] = (unsigned char)(v >> 16); q[3] = (unsigned char)(v >> 24);
+            } else
+                for (k=0; k<x->row[r].len; k++)
+                    q[k] = (unsigned char)(v >> 8*k);
+        }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * S S S E 3   P A T H
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifdef HAVE_SSSE3
+/* Rows of four lanes <-> four vectors of four limbs; the same
+ * unpacks transpose in both directions                            */
+#define T4(a, b, c, d) do {                                         \
+    __m128i t0 = _mm_unpacklo_epi32(a, b), t1 = _mm_unpacklo_epi32(c, d); \
+    __m128i t2 = _mm_unpackhi_epi32(a, b), t3 = _mm_unpackhi_epi32(c, d); \
+    a = _mm_unpacklo_epi64(t0, t1); b = _mm_unpackhi_epi64(t0, t1);  \
+    c = _mm_unpacklo_epi64(t2, t3); d = _mm_unpackhi_epi64(t2, t3);  \
+} while (0)
+
+/* Block j of the batch as 16 bytes. Blocks are shorter than that,
+ * so the last few are copied out rather than read past the end.   */
+__attribute__((target("ssse3")))
+static __m128i get16(const xpose *x, const unsigned char *p, int j) {
+    unsigned char t[16];
+    if (j*x->bpb + 16 <= x->lanes*x->bpb)
+        return _mm_loadu_si128((const __m128i *)(p + j*x->bpb));
+    memset(t, 0, 16);
+    memcpy(t, p + j*x->bpb, (size_t)x->bpb);
+    return _mm_loadu_si128((const __m128i *)t);
+}
+
+__attribute__((target("ssse3")))
+static void load_shuf(const xpose *x, const unsigned char *p,
+                      uint32_t *const rows[]) {
+    __m128i ctl = _mm_loadu_si128((const __m128i *)x->ctl), r[4];
+    int g, k, L = x->lanes, nr = x->words*x->nl;
+    for (g=0; g<L; g+=4) {
+        for (k=0; k<4; k++) r[k] = _mm_shuffle_epi8(get16(x, p, g+k), ctl);
+        T4(r[0], r[1], r[2], r[3]);
+        for (k=0; k<nr; k++)
+            _mm_storeu_si128((__m128i *)(rows[k/x->nl] + k%x->nl*L + g), r[k]);
+    }
+}
+
+__attribute__((target("ssse3")))
+static void store_shuf(const xpose *x, unsigned char *p,
+                       uint32_t *const rows[]) {
+    __m128i ictl = _mm_loadu_si128((const __m128i *)x->ictl), r[4];
+    unsigned char t[16];
+    int g, k, L = x->lanes, nr = x->words*x->nl, bpb = x->bpb;
+    for (g=0; g<L; g+=4) {
+        for (k=0; k<4; k++)
+            r[k] = (k < nr ? _mm_loadu_si128((const __m128i *)
+                             (rows[k/x->nl] + k%x->nl*L + g))
+                           : _mm_setzero_si128());
+        T4(r[0], r[1], r[2], r[3]);
+        for (k=0; k<4; k++) {
+            __m128i b = _mm_shuffle_epi8(r[k], ictl);
+            /* A 16-byte store spills into the next blocks, which are
+             * written after it; only the batch's last ones bounce. */
+            if ((g+k)*bpb + 16 <= L*bpb)
+                _mm_storeu_si128((__m128i *)(p + (g+k)*bpb), b);
+            else {
+                _mm_storeu_si128((__m128i *)t, b);
+                memcpy(p + (g+k)*bpb, t, (size_t)bpb);
+            }
+        }
+    }
+}
+#endif
+
+void xpose_load(const xpose *x, const void *blocks, uint32_t *const rows[]) {
+#ifdef HAVE_SSSE3
+    if (x->shuf) { load_shuf(x, (const unsigned char *)blocks, rows); return; }
+#endif
+    load_table(x, (const unsigned char *)blocks, rows);
+}
+
+void xpose_store(const xpose *x, void *blocks, uint32_t *const rows[]) {
+#ifdef HAVE_SSSE3
+    if (x->shuf) { store_shuf(x, (unsigned char *)blocks, rows); return; }
+#endif
+    store_table(x, (unsigned char *)blocks, rows);
+}
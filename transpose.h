@@ -0,0 +1,51 @@
+/*
+// Block <-> lane transposition for multi-block RC6/RC5 kernels.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* A multi-block kernel holds limb i of word v of every block in one
+ * row, lane j of the row belonging to block j. xpose_load builds the
+ * rows from lanes contiguous blocks and xpose_store writes them
+ * back. Limbs are 32 bits, little-endian like the words, so a w-bit
+ * word is (w+31)/32 rows and the top limb is zero-padded when w is
+ * not a multiple of 32.
+ *
+ * Words of w/8 bytes put limbs at arbitrary byte offsets (RC6-24 has
+ * 12-byte blocks, RC5-80 20-byte ones and RC6-80 40-byte ones), so
+ * xpose_init precomputes, for each row, the byte offset and mask of
+ * its limb in a block and whether a 4-byte load there stays inside
+ * the block. Blocks of at most 16 bytes are moved with one SSSE3
+ * byte shuffle per block and a 4x4 transpose when the CPU has it.
+ */
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include <stdint.h>
+
+#define XP_ROWS 128     /* Most rows: RC6 with w=1024, 4x32 limbs   */
+
+typedef struct {
+    int w, words, lanes, nl, bpb;
+    int shuf;                   /* Nonzero to use the SSSE3 path   */
+    struct {
+        unsigned short off;     /* Byte offset of the limb in block */
+        unsigned char len;      /* Bytes of it in the word, 1..4   */
+        unsigned char whole;    /* 4-byte load stays in the block  */
+        uint32_t mask;          /* Keeps the len low bytes         */
+    } row[XP_ROWS];
+    unsigned char ctl[16];      /* Block bytes -> limbs, 0x80 = 0  */
+    unsigned char ictl[16];     /* Limbs -> block bytes            */
+} xpose;
+
+/* Plan for blocks of words w-bit words, 8 <= w <= 1024, w%8==0,
+ * 1 <= words <= 4, moved lanes at a time. Returns 0 on success.   */
+int xpose_init(xpose *x, int w, int words, int lanes);
+
+/* rows[v] is word v's first row; its nl rows follow it, lanes
+ * uint32_t apart. blocks holds lanes*bpb bytes.                   */
+void xpose_load(const xpose *x, const void *blocks, uint32_t *const rows[]);
+void xpose_store(const xpose *x, void *blocks, uint32_t *const rows[]);
+
+#endif
@@ -0,0 +1,355 @@
+/*
+// Decrypt-on-access memory regions with Linux userfaultfd.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - Linux 4.3 or later with userfaultfd, POSIX threads, and
+ *   executor.c for readahead.
+ * - A host page size that is a multiple of UFFD_SECTOR.
+ * - GCC or Clang __atomic builtins for the page bitmap.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+#include "uffd.h"
+
+#define RA_QUEUE 64     /* Pending readahead runs; more are dropped  */
+
+struct uffd_region {
+    const blkcipher *bc;
+    unsigned char iv[BLK_MAX];
+    const unsigned char *ct;
+    unsigned char *base;                /* The registered mapping   */
+    size_t len, psz, npages;
+    unsigned long *claimed;             /* Bit per page taken to fill */
+    unsigned char *hbuf;                /* The handler's scratch page */
+    size_t resident;
+    int fd, stop;                       /* userfaultfd and eventfd  */
+    int readahead, running;             /* running: handler started */
+    executor *ex;                       /* Runs readahead, or NULL  */
+    pthread_t handler;
+    pthread_mutex_t mu;                 /* Guards the queue below   */
+    pthread_cond_t cv;                  /* inflight reached 0       */
+    size_t queue[RA_QUEUE];             /* First page of each run   */
+    unsigned head, count;
+    int inflight, nspare;               /* Tasks not done, buffers  */
+    unsigned char *spare[RA_QUEUE];     /* Scratch pages for tasks  */
+    int quit;
+};
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * S E C T O R   E N C R Y P T I O N
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* ctr = iv + s*ceil(UFFD_SECTOR/bpb), big-endian over bpb bytes    */
+static void sector_ctr(const blkcipher *bc, const unsigned char *iv,
+                       uint64_t s, unsigned char *ctr) {
+    uint64_t n = (uint64_t)bc->bpb, k = s * ((UFFD_SECTOR + n-1) / n);
+    unsigned c = 0;
+    int i;
+    memcpy(ctr, iv, (size_t)n);
+    for (i=(int)n-1; i>=0 && (k || c); i--, k>>=8) {
+        c += ctr[i] + (unsigned)(k & 0xff);
+        ctr[i] = (unsigned char)c;
+        c >>= 8;
+    }
+}
+
+/* CTR over len bytes starting at sector-aligned offset off         */
+static void xcrypt(const blkcipher *bc, const unsigned char *iv,
+                  size_t off, const unsigned char *in, unsigned char *out,
+                  size_t len) {
+    unsigned char ctr[BLK_MAX];
+    uint64_t s = off / UFFD_SECTOR;
+    size_t n;
+    for ( ; len > 0; s++, in+=n, out+=n, len-=n) {
+        n = (len < UFFD_SECTOR ? len : UFFD_SECTOR);
+        sector_ctr(bc, iv, s, ctr);
+        ctr_crypt(bc, ctr, in, out, n);
+    }
+}
+
+void uffd_encrypt(const blkcipher *bc, const void *iv,
+                  const void *pt, void *ct, size_t len) {
+    xcrypt(bc, (const unsigned char *)iv, 0, (const unsigned char *)pt,
+          (unsigned char *)ct, len);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * P A G E   F I L L I N G
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#define LBITS (8*sizeof(unsigned long))
+
+/* Nonzero if this call claimed page p; only the claimer fills it  */
+static int claim(uffd_region *u, size_t p) {
+    unsigned long b = 1UL << (p % LBITS), *w = &u->claimed[p / LBITS];
+    if (__atomic_load_n(w, __ATOMIC_RELAXED) & b) return 0;
+    return !(__atomic_fetch_or(w, b, __ATOMIC_ACQ_REL) & b);
+}
+
+/* Decrypt page p through buf and map it in, unless another thread
+ * has it. A thread faulting on a page claimed by someone else sleeps
+ * until that UFFDIO_COPY wakes it; if the copy fails, the claim is
+ * dropped and the sleeper woken to fault again and retry.         */
+static void fill(uffd_region *u, size_t p, unsigned char *buf) {
+    struct uffdio_copy cp;
+    struct uffdio_range rg;
+    size_t off = p*u->psz, n;
+    if (p >= u->npages || !claim(u, p)) return;
+    n = (u->len - off < u->psz ? u->len - off : u->psz);
+    xcrypt(u->bc, u->iv, off, u->ct + off, buf, n);
+    memset(buf + n, 0, u->psz - n);
+    cp.dst = (uintptr_t)(u->base + off);
+    cp.src = (uintptr_t)buf;
+    cp.len = u->psz;
+    cp.mode = 0;
+    cp.copy = 0;
+    if (ioctl(u->fd, UFFDIO_COPY, &cp) == 0 || errno == EEXIST) {
+        __atomic_fetch_add(&u->resident, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_fetch_and(&u->claimed[p / LBITS], ~(1UL << (p % LBITS)),
+                       __ATOMIC_ACQ_REL);
+    rg.start = cp.dst;
+    rg.len = u->psz;
+    ioctl(u->fd, UFFDIO_WAKE, &rg);
+}
+
+static unsigned char *scratch(const uffd_region *u) {
+    void *p = mmap(NULL, u->psz, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (p == MAP_FAILED ? NULL : (unsigned char *)p);
+}
+
+static void scratch_free(const uffd_region *u, unsigned char *buf) {
+    if (buf == NULL) return;
+    memset(buf, 0, u->psz);
+    munmap(buf, u->psz);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * T H R E A D S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+static void prefetch(uffd_region *u, size_t first, unsigned char *buf) {
+    size_t p;
+    for (p=first; p<first+(size_t)u->readahead && p<u->npages; p++)
+        fill(u, p, buf);
+}
+
+/* Executor task: fill the oldest queued run with a spare scratch
+ * page, unless the region is closing                              */
+static void ra_task(void *arg) {
+    uffd_region *u = (uffd_region *)arg;
+    unsigned char *buf = NULL;
+    size_t first = 0;
+    int have = 0;
+    pthread_mutex_lock(&u->mu);
+    if (!u->quit && u->count > 0) {
+        first = u->queue[u->head];
+        u->head = (u->head + 1) % RA_QUEUE;
+        u->count--;
+        have = 1;
+        if (u->nspare > 0) buf = u->spare[--u->nspare];
+    }
+    pthread_mutex_unlock(&u->mu);
+    if (have && buf == NULL) buf = scratch(u);
+    if (have && buf) prefetch(u, first, buf);
+    pthread_mutex_lock(&u->mu);
+    if (buf) u->spare[u->nspare++] = buf;
+    if (--u->inflight == 0) pthread_cond_broadcast(&u->cv);
+    pthread_mutex_unlock(&u->mu);
+}
+
+/* Readahead is advisory: with RA_QUEUE tasks outstanding the run is
+ * dropped. The task is submitted outside mu, as it may run inline. */
+static void enqueue(uffd_region *u, size_t first) {
+    int ok = 0;
+    pthread_mutex_lock(&u->mu);
+    if (u->inflight < RA_QUEUE) {
+        u->queue[(u->head + u->count) % RA_QUEUE] = first;
+        u->count++;
+        u->inflight++;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&u->mu);
+    if (ok)
+        u->ex->submit(u->ex->self, ra_task, u,
+                      (size_t)u->readahead * u->psz);
+}
+
+/* The handler's page comes from uffd_open: if it could not run,
+ * faulting threads would sleep forever                            */
+static void *handler(void *arg) {
+    uffd_region *u = (uffd_region *)arg;
+    unsigned char *buf = u->hbuf;
+    struct uffd_msg msg;
+    struct pollfd pfd[2];
+    size_t p;
+    pfd[0].fd = u->fd;   pfd[0].events = POLLIN;
+    pfd[1].fd = u->stop; pfd[1].events = POLLIN;
+    for (;;) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfd[1].revents) break;
+        if (read(u->fd, &msg, sizeof(msg)) != (ssize_t)sizeof(msg) ||
+            msg.event != UFFD_EVENT_PAGEFAULT)
+            continue;
+        p = (size_t)(msg.arg.pagefault.address - (uintptr_t)u->base)
+            / u->psz;
+        fill(u, p, buf);
+        if (u->readahead > 0) {
+            if (u->ex) enqueue(u, p+1);
+            else prefetch(u, p+1, buf);
+        }
+    }
+    return NULL;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * R E G I O N S
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Faults from the kernel too when allowed, since without them a
+ * syscall reading an unfilled page fails with EFAULT; else
+ * user-mode-only faults, which need no privilege from Linux 5.11 on */
+static int open_uffd(void) {
+    int fd = (int)syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+#ifdef UFFD_USER_MODE_ONLY
+    if (fd < 0)
+        fd = (int)syscall(SYS_userfaultfd,
+                          O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+#endif
+    return fd;
+}
+
+/* Undo whatever uffd_open got done; the handler must be stopped and
+ * no readahead task outstanding                                   */
+static void teardown(uffd_region *u) {
+    size_t p;
+    if (u->base) {
+        if (u->fd >= 0) {
+            struct uffdio_range rg;
+            rg.start = (uintptr_t)u->base;
+            rg.len = u->npages*u->psz;
+            ioctl(u->fd, UFFDIO_UNREGISTER, &rg);
+        }
+        /* Only filled pages hold plaintext; touching others would
+         * just allocate zero pages                                */
+        for (p=0; u->claimed && p<u->npages; p++)
+            if (u->claimed[p / LBITS] & (1UL << (p % LBITS)))
+                memset(u->base + p*u->psz, 0, u->psz);
+        munmap(u->base, u->npages*u->psz);
+    }
+    scratch_free(u, u->hbuf);
+    while (u->nspare > 0) scratch_free(u, u->spare[--u->nspare]);
+    if (u->fd >= 0) close(u->fd);
+    if (u->stop >= 0) close(u->stop);
+    free(u->claimed);
+    memset(u->iv, 0, sizeof(u->iv));
+    pthread_mutex_destroy(&u->mu);
+    pthread_cond_destroy(&u->cv);
+    free(u);
+}
+
+uffd_region *uffd_open(const blkcipher *bc, const void *iv,
+                       const void *ct, size_t len,
+                       int readahead, executor *ex) {
+    struct uffdio_api api;
+    struct uffdio_register reg;
+    long psz = sysconf(_SC_PAGESIZE);
+    uffd_region *u;
+    int t;
+    if (len == 0 || bc->bpb > BLK_MAX || psz <= 0 || psz % UFFD_SECTOR) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if ((u = (uffd_region *)calloc(1, sizeof(uffd_region))) == NULL)
+        return NULL;
+    u->bc = bc;
+    memcpy(u->iv, iv, (size_t)bc->bpb);
+    u->ct = (const unsigned char *)ct;
+    u->len = len;
+    u->psz = (size_t)psz;
+    u->npages = (len + u->psz-1) / u->psz;
+    u->readahead = (readahead < 0 ? 0 : readahead);
+    u->ex = ex;
+    u->fd = u->stop = -1;
+    pthread_mutex_init(&u->mu, NULL);
+    pthread_cond_init(&u->cv, NULL);
+    u->claimed = (unsigned long *)calloc((u->npages + LBITS-1) / LBITS,
+                                         sizeof(unsigned long));
+    u->base = (unsigned char *)mmap(NULL, u->npages*u->psz,
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (u->base == MAP_FAILED) u->base = NULL;
+    u->hbuf = scratch(u);
+    if (u->claimed == NULL || u->base == NULL || u->hbuf == NULL ||
+        (u->fd = open_uffd()) < 0 ||
+        (u->stop = eventfd(0, EFD_CLOEXEC)) < 0)
+        goto fail;
+    memset(&api, 0, sizeof(api));
+    api.api = UFFD_API;
+    if (ioctl(u->fd, UFFDIO_API, &api) < 0) goto fail;
+    memset(&reg, 0, sizeof(reg));
+    reg.range.start = (uintptr_t)u->base;
+    reg.range.len = u->npages*u->psz;
+    reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+    if (ioctl(u->fd, UFFDIO_REGISTER, &reg) < 0) goto fail;
+    if (!(reg.ioctls & ((__u64)1 << _UFFDIO_COPY))) {
+        errno = ENOTSUP;
+        goto fail;
+    }
+    if ((t = pthread_create(&u->handler, NULL, handler, u)) != 0) {
+        uffd_close(u);
+        errno = t;
+        return NULL;
+    }
+    u->running = 1;
+    return u;
+fail:
+    t = errno;
+    teardown(u);
+    errno = t;
+    return NULL;
+}
+
+void *uffd_addr(const uffd_region *u) {
+    return u->base;
+}
+
+size_t uffd_resident(const uffd_region *u) {
+    return __atomic_load_n(&u->resident, __ATOMIC_RELAXED);
+}
+
+void uffd_close(uffd_region *u) {
+    uint64_t one = 1;
+    if (u == NULL) return;
+    if (u->running && write(u->stop, &one, sizeof(one)) > 0)
+        pthread_join(u->handler, NULL);
+    /* Queued tasks still hold u; they see quit and return at once  */
+    pthread_mutex_lock(&u->mu);
+    u->quit = 1;
+    while (u->inflight > 0)
+        pthread_cond_wait(&u->cv, &u->mu);
+    pthread_mutex_unlock(&u->mu);
+    teardown(u);
+}
@@ -0,0 +1,72 @@
+/*
+// Decrypt-on-access memory regions with Linux userfaultfd.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* uffd_open reserves an anonymous region the size of the plaintext
+ * and registers it with userfaultfd, so nothing is decrypted up
+ * front. The first touch of a page faults to a handler thread, which
+ * decrypts that page from the ciphertext and maps it in with
+ * UFFDIO_COPY; later touches cost nothing. Startup is O(1) and the
+ * resident size grows with the pages touched, not the file size.
+ *
+ * Ciphertext is CTR mode over UFFD_SECTOR-byte sectors. Sector s is
+ * keyed by its index: its first counter is iv + s*ceil(UFFD_SECTOR/
+ * bpb), so when bpb divides UFFD_SECTOR (any w that is a power of
+ * two) the file is just ctr_crypt of the plaintext from iv, and any
+ * sector can be decrypted alone. The sector is fixed rather than the
+ * host page size so files are portable between 4K and 16K/64K page
+ * kernels; a host page spans one or more sectors.
+ *
+ * With readahead > 0 each fault also queues the next readahead pages,
+ * which tasks on an executor (or the handler itself when there is
+ * none) fill before they are touched. Writes to the region stay in
+ * memory and are never encrypted back.
+ *
+ * Faults are taken from user and kernel accesses alike when the
+ * process may ask for that: with CAP_SYS_PTRACE, or when
+ * vm.unprivileged_userfaultfd=1. Otherwise, on Linux 5.11 or later,
+ * the region falls back to user-mode-only faults. Then a syscall that
+ * reads or writes a page of the region no thread has touched yet
+ * (write, send or pwrite from it, read into it) fails with EFAULT
+ * rather than waiting for the page. Touch such pages first, eg with
+ * a load per page, before handing the region to the kernel.
+ */
+#ifndef UFFD_H
+#define UFFD_H
+
+#include <stddef.h>
+#include "modes.h"
+#include "executor.h"
+
+#define UFFD_SECTOR 4096    /* Bytes per CTR tweak unit              */
+
+typedef struct uffd_region uffd_region;
+
+/* Encrypt len bytes of pt to ct in the format above; pt == ct is
+ * allowed. iv is bc->bpb bytes.                                   */
+void uffd_encrypt(const blkcipher *bc, const void *iv,
+                  const void *pt, void *ct, size_t len);
+
+/* Map len bytes of plaintext backed by ct (typically a read-only
+ * mmap of the encrypted file). bc, its key schedule and ct must
+ * outlive the region; bc is used from several threads at once.
+ * Readahead runs as tasks on ex, eg exec_default(), or on the
+ * handler thread if ex is NULL. Returns NULL with errno set if
+ * userfaultfd is unavailable or resources run out.               */
+uffd_region *uffd_open(const blkcipher *bc, const void *iv,
+                       const void *ct, size_t len,
+                       int readahead, executor *ex);
+
+/* Start of the plaintext: len readable and writable bytes          */
+void *uffd_addr(const uffd_region *u);
+
+/* Pages decrypted so far, by faults and by readahead              */
+size_t uffd_resident(const uffd_region *u);
+
+/* Stop the threads, wipe and unmap the region                    */
+void uffd_close(uffd_region *u);
+
+#endif
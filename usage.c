@@ -0,0 +1,386 @@
+/*
+// Block-usage accounting and automatic rekeying for small blocks.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Requirements of this implementation:
+ * - An rc6.h implementation (rc6.c, rc6_ref.c), modes.c, kdf.c,
+ *   arena.c and executor.c, and POSIX threads.
+ * - GCC or Clang __atomic builtins for the counters and the swap.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "rc6.h"
+#include "arena.h"
+#include "kdf.h"
+#include "usage.h"
+#include "probes.h"
+
+#define NSCHED 4            /* Current, next and two still held      */
+#define MAX_SCHED (USAGE_MAX_THREADS + 2)   /* One held per thread   */
+#define LEASES 256          /* Leases per epoch, so the CAS is rare   */
+
+struct sched {
+    uint64_t epoch;
+    uint64_t issued;            /* Blocks leased out, by CAS        */
+    struct sched *next;         /* Schedule of epoch+1 once ready   */
+    void *rkey;
+    int live;                   /* In use or held; guarded by mu    */
+};
+
+struct usage_thread {
+    usage *u;
+    struct sched *hold;         /* Hazard pointer, or NULL          */
+    uint64_t epoch, left;       /* Lease: its epoch, blocks unused  */
+    uint64_t used, stalls;      /* Also read by usage_stats         */
+    int taken;
+};
+
+struct usage {
+    int cipher, w, r, keylen, flags;
+    size_t rkb;
+    uint64_t limit, lease;
+    struct sched *cur;          /* Swapped by whoever ends an epoch */
+    uint64_t epoch;             /* cur->epoch, for usage_stats      */
+    struct sched *sc[MAX_SCHED];    /* One cache line each          */
+    int nsc;                    /* Made so far; guarded by mu       */
+    arena *more[MAX_SCHED - NSCHED];    /* Of schedules past NSCHED */
+    usage_thread *slot[USAGE_MAX_THREADS];
+    uint64_t gone_used, gone_stalls;    /* Of detached threads      */
+    kdf *k;                     /* Guarded by mu                    */
+    executor *ex;               /* Runs refill tasks                */
+    int queued, inflight;       /* Refills not started, not done    */
+    pthread_mutex_t mu;
+    pthread_cond_t idle;        /* inflight reached 0               */
+    arena *mem;                 /* Holds all of the above           */
+};
+
+static size_t round_up(size_t x, size_t m) { return (x+m-1)/m*m; }
+
+/* Clear keys through volatile so the stores are not elided        */
+static void wipe(void *p, size_t n) {
+    volatile unsigned char *v = (volatile unsigned char *)p;
+    while (n--) *v++ = 0;
+}
+
+/* Schedule of epoch e into s->rkey; call with mu held             */
+static int expand(usage *u, struct sched *s, uint64_t e) {
+    unsigned char key[256];
+    int ret;
+    kdf_derive(u->k, &e, 1, key);
+    if (u->cipher == USAGE_RC6)
+        ret = rc6_setup(s->rkey, u->w, u->r, u->keylen, key);
+    else
+        ret = rc5_setup(s->rkey, u->w, u->r, u->keylen, key);
+    wipe(key, sizeof(key));
+    return ret;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * R E K E Y I N G
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Nonzero if some thread holds s                                  */
+static int held(const usage *u, const struct sched *s) {
+    int i;
+    for (i=0; i<USAGE_MAX_THREADS; i++)
+        if (__atomic_load_n(&u->slot[i]->hold, __ATOMIC_SEQ_CST) == s)
+            return 1;
+    return 0;
+}
+
+/* One more schedule in an arena of its own, or NULL. Each thread
+ * holds at most one, so with MAX_SCHED made one is always free.
+ * Call with mu held.                                              */
+static struct sched *grow(usage *u) {
+    size_t sz = round_up(sizeof(struct sched), ARENA_ALIGN) + u->rkb;
+    struct sched *s;
+    arena *a;
+    if (u->nsc == MAX_SCHED || (a = arena_create(sz, u->flags)) == NULL)
+        return NULL;
+    s = (struct sched *)arena_alloc(a, sizeof(struct sched));
+    memset(s, 0, sizeof(struct sched));
+    s->rkey = arena_alloc(a, u->rkb);
+    u->more[u->nsc - NSCHED] = a;
+    return u->sc[u->nsc++] = s;
+}
+
+/* Wipe schedules of past epochs that nobody holds, then expand the
+ * successor of the current one if there is a free schedule for it,
+ * making one if must is set. Call with mu held.                   */
+static void refill(usage *u, int must) {
+    struct sched *c = __atomic_load_n(&u->cur, __ATOMIC_SEQ_CST);
+    struct sched *f = NULL, *s;
+    int i;
+    for (i=0; i<u->nsc; i++) {
+        s = u->sc[i];
+        if (s->live && s != c && s != c->next && !held(u, s)) {
+            wipe(s->rkey, u->rkb);
+            s->live = 0;
+        }
+        if (!s->live && f == NULL) f = s;
+    }
+    if (c->next == NULL && f == NULL && must)
+        f = grow(u);
+    if (c->next == NULL && f != NULL) {
+        expand(u, f, c->epoch+1);
+        f->epoch = c->epoch+1;
+        f->issued = 0;
+        f->next = NULL;
+        f->live = 1;
+        __atomic_store_n(&c->next, f, __ATOMIC_RELEASE);
+    }
+}
+
+static void refill_task(void *arg) {
+    usage *u = (usage *)arg;
+    pthread_mutex_lock(&u->mu);
+    u->queued = 0;
+    refill(u, 0);
+    if (--u->inflight == 0) pthread_cond_broadcast(&u->idle);
+    pthread_mutex_unlock(&u->mu);
+}
+
+/* Submit a refill unless one is waiting to start. Outside mu, since
+ * the executor may run it inline.                                 */
+static void kick(usage *u) {
+    int go = 0;
+    pthread_mutex_lock(&u->mu);
+    if (!u->queued) {
+        u->queued = 1;
+        u->inflight++;
+        go = 1;
+    }
+    pthread_mutex_unlock(&u->mu);
+    if (go)
+        u->ex->submit(u->ex->self, refill_task, u, u->rkb);
+}
+
+/* End the epoch of s: swap its successor in, refilling here if the
+ * task has not got to it (the executor is busy, or past schedules
+ * are still held). Losing the swap to another thread is fine;
+ * either way cur has moved on. Returns -1 if no schedule could be
+ * made for the successor.                                         */
+static int rotate(usage_thread *t, struct sched *s) {
+    usage *u = t->u;
+    struct sched *n = __atomic_load_n(&s->next, __ATOMIC_ACQUIRE);
+    int stalled = (n == NULL);
+    if (stalled) {
+        pthread_mutex_lock(&u->mu);
+        refill(u, 1);
+        n = s->next;
+        pthread_mutex_unlock(&u->mu);
+        __atomic_store_n(&t->stalls, t->stalls+1, __ATOMIC_RELAXED);
+        if (n == NULL)
+            return -1;
+    }
+    /* n is not held, so may be reused as soon as it is current; its
+     * epoch is read from s instead                                */
+    if (__atomic_compare_exchange_n(&u->cur, &s, n, 0, __ATOMIC_SEQ_CST,
+                                    __ATOMIC_RELAXED)) {
+        __atomic_store_n(&u->epoch, s->epoch+1, __ATOMIC_RELAXED);
+        PROBE3(rekey, u->w, s->epoch+1, stalled);
+        kick(u);
+    }
+    return 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * C O U N T I N G
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Publish a hold on the current schedule. Rechecking cur after the
+ * store means refill, which reads cur before the holds, either
+ * sees this hold or this thread sees the new cur.                 */
+static struct sched *hold(usage_thread *t) {
+    struct sched *s;
+    do {
+        s = __atomic_load_n(&t->u->cur, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&t->hold, s, __ATOMIC_SEQ_CST);
+    } while (s != __atomic_load_n(&t->u->cur, __ATOMIC_SEQ_CST));
+    return s;
+}
+
+/* Lease at least n blocks of s's epoch; 0 if it has fewer left    */
+static int lease(usage_thread *t, struct sched *s, uint64_t n) {
+    usage *u = t->u;
+    uint64_t have = __atomic_load_n(&s->issued, __ATOMIC_RELAXED), want;
+    do {
+        if (have > u->limit - n)
+            return 0;
+        want = (n > u->lease ? n : u->lease);
+        if (want > u->limit - have) want = u->limit - have;
+    } while (!__atomic_compare_exchange_n(&s->issued, &have, have+want, 1,
+                                          __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+    t->epoch = s->epoch;
+    t->left = want;
+    return 1;
+}
+
+uint64_t usage_default_limit(int b) {
+    int e = b/2 - 4;
+    if (e < 0) e = 0;
+    if (e > 63) e = 63;
+    return UINT64_C(1) << e;
+}
+
+usage *usage_create(int cipher, int w, int r, const void *master,
+                    int mlen, int keylen, uint64_t limit, int flags,
+                    executor *ex) {
+    usage *u;
+    arena *mem;
+    size_t rkb, sz;
+    int i, nw;
+    if ((cipher != USAGE_RC6 && cipher != USAGE_RC5) || w < 8 ||
+        w > 1024 || r<0 || r>255 || mlen<0 || mlen>255 ||
+        keylen<1 || keylen>255)
+        return NULL;
+    nw = (cipher == USAGE_RC6 ? 2*r+4 : 2*r+2);
+    rkb = round_up((size_t)(w/8)*nw, ARENA_ALIGN);
+    sz = round_up(sizeof(usage), ARENA_ALIGN) +
+         NSCHED*(round_up(sizeof(struct sched), ARENA_ALIGN) + rkb) +
+         USAGE_MAX_THREADS*round_up(sizeof(usage_thread), ARENA_ALIGN);
+    if ((mem = arena_create(sz, flags)) == NULL)
+        return NULL;
+    u = (usage *)arena_alloc(mem, sizeof(usage));
+    memset(u, 0, sizeof(usage));
+    u->mem = mem;
+    u->cipher = cipher; u->w = w; u->r = r; u->keylen = keylen;
+    u->flags = flags;
+    u->rkb = rkb;
+    u->limit = (limit ? limit : usage_default_limit(cipher == USAGE_RC6 ?
+                                                    4*w : 2*w));
+    u->lease = (u->limit/LEASES ? u->limit/LEASES : 1);
+    for (i=0; i<NSCHED; i++) {
+        u->sc[i] = (struct sched *)arena_alloc(mem, sizeof(struct sched));
+        memset(u->sc[i], 0, sizeof(struct sched));
+        u->sc[i]->rkey = arena_alloc(mem, rkb);
+    }
+    u->nsc = NSCHED;
+    for (i=0; i<USAGE_MAX_THREADS; i++) {
+        u->slot[i] = (usage_thread *)arena_alloc(mem, sizeof(usage_thread));
+        memset(u->slot[i], 0, sizeof(usage_thread));
+        u->slot[i]->u = u;
+    }
+    if ((u->k = kdf_create(20, master, mlen, keylen, 4, flags)) == NULL)
+        goto fail_kdf;
+    if (expand(u, u->sc[0], 0))
+        goto fail_setup;
+    u->sc[0]->live = 1;
+    u->cur = u->sc[0];
+    u->ex = (ex ? ex : exec_default());
+    pthread_mutex_init(&u->mu, NULL);
+    pthread_cond_init(&u->idle, NULL);
+    kick(u);
+    return u;
+fail_setup:
+    kdf_destroy(u->k);
+fail_kdf:
+    arena_destroy(mem);
+    return NULL;
+}
+
+void usage_destroy(usage *u) {
+    int i;
+    if (u == NULL)
+        return;
+    pthread_mutex_lock(&u->mu);
+    while (u->inflight > 0)
+        pthread_cond_wait(&u->idle, &u->mu);
+    pthread_mutex_unlock(&u->mu);
+    pthread_cond_destroy(&u->idle);
+    pthread_mutex_destroy(&u->mu);
+    kdf_destroy(u->k);
+    for (i=NSCHED; i<u->nsc; i++) arena_destroy(u->more[i - NSCHED]);
+    arena_destroy(u->mem);
+}
+
+usage_thread *usage_attach(usage *u) {
+    int i, none;
+    for (i=0; i<USAGE_MAX_THREADS; i++) {
+        usage_thread *t = u->slot[i];
+        none = 0;
+        if (__atomic_compare_exchange_n(&t->taken, &none, 1, 0,
+                                        __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED)) {
+            t->epoch = UINT64_MAX;
+            t->left = 0;
+            return t;
+        }
+    }
+    return NULL;
+}
+
+void usage_detach(usage_thread *t) {
+    usage *u = t->u;
+    usage_release(t);
+    pthread_mutex_lock(&u->mu);
+    u->gone_used += t->used;
+    u->gone_stalls += t->stalls;
+    __atomic_store_n(&t->used, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->stalls, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&u->mu);
+    __atomic_store_n(&t->taken, 0, __ATOMIC_RELEASE);
+}
+
+int usage_acquire(usage_thread *t, size_t nblocks, blkcipher *bc,
+                  uint64_t *epoch) {
+    usage *u = t->u;
+    uint64_t n = nblocks;
+    struct sched *s;
+    if (n > u->limit)
+        return -1;
+    for (;;) {
+        s = hold(t);
+        if ((t->epoch == s->epoch && t->left >= n) || lease(t, s, n))
+            break;
+        if (rotate(t, s)) {
+            usage_release(t);
+            return -1;
+        }
+    }
+    t->left -= n;
+    __atomic_store_n(&t->used, t->used + n, __ATOMIC_RELAXED);
+    if (u->cipher == USAGE_RC6)
+        blkcipher_rc6(bc, s->rkey, u->w, u->r);
+    else
+        blkcipher_rc5(bc, s->rkey, u->w, u->r);
+    if (epoch) *epoch = s->epoch;
+    return 0;
+}
+
+void usage_release(usage_thread *t) {
+    __atomic_store_n(&t->hold, NULL, __ATOMIC_RELEASE);
+}
+
+int usage_schedule(usage *u, uint64_t epoch, void *rkey) {
+    struct sched s;
+    int ret;
+    s.rkey = rkey;
+    pthread_mutex_lock(&u->mu);
+    ret = expand(u, &s, epoch);
+    pthread_mutex_unlock(&u->mu);
+    return (ret ? -1 : 0);
+}
+
+void usage_stats(usage *u, uint64_t *blocks, uint64_t *epoch,
+                 uint64_t *stalls) {
+    uint64_t b, st;
+    int i;
+    pthread_mutex_lock(&u->mu);
+    b = u->gone_used; st = u->gone_stalls;
+    for (i=0; i<USAGE_MAX_THREADS; i++) {
+        b += __atomic_load_n(&u->slot[i]->used, __ATOMIC_RELAXED);
+        st += __atomic_load_n(&u->slot[i]->stalls, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&u->mu);
+    if (blocks) *blocks = b;
+    if (epoch) *epoch = __atomic_load_n(&u->epoch, __ATOMIC_RELAXED);
+    if (stalls) *stalls = st;
+}
@@ -0,0 +1,93 @@
+/*
+// Block-usage accounting and automatic rekeying for small blocks.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Among q blocks enciphered under one key, some two collide with
+ * probability about q^2/2^(b+1) for b-bit blocks, and in CTR or CBC
+ * each collision leaks plaintext. With the small blocks this library
+ * allows that happens soon: after some 2^(b/2) blocks, ie 256 for
+ * RC5-8, 65536 for RC6-8 and RC5-16. A usage object counts the blocks
+ * enciphered under its key and, once limit blocks are used, moves to
+ * the key of the next epoch. The key of epoch e is child e of a
+ * master key in kdf.c, so any epoch's key can be had again to decrypt.
+ *
+ * Each thread attaches once and takes leases of blocks from the
+ * current epoch with one compare-and-swap per lease, then counts the
+ * blocks of each call in its own cache line, so there is no shared
+ * atomic per block or per call. A lease never exceeds what the epoch
+ * has left, so no key enciphers more than limit blocks; blocks leased
+ * but unused when an epoch ends are lost to it. Totals are summed
+ * over the threads when usage_stats asks for them.
+ *
+ * A task on an executor (executor.h) expands the schedule of epoch
+ * e+1 as soon as epoch e starts, so the switch is normally one
+ * pointer swap. A call that finds the next schedule not yet ready
+ * expands it itself and counts as a stall. Schedules of past epochs
+ * are reused once no thread holds them; while threads hold them all,
+ * another is allocated, up to two more than USAGE_MAX_THREADS.
+ */
+#ifndef USAGE_H
+#define USAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "modes.h"
+#include "executor.h"
+
+#define USAGE_RC6 6
+#define USAGE_RC5 5
+#define USAGE_MAX_THREADS 64    /* Attached at once                  */
+
+typedef struct usage usage;
+typedef struct usage_thread usage_thread;
+
+/* Blocks per key for b-bit blocks: 2^(b/2-4), at least 1, so that a
+ * collision within one epoch has probability about 2^-9            */
+uint64_t usage_default_limit(int b);
+
+/* cipher is USAGE_RC6 or USAGE_RC5 with w and r as rc6_setup or
+ * rc5_setup accepts them. Epoch keys are keylen (1..255) bytes,
+ * derived from master (mlen 0..255 bytes). limit is blocks per epoch,
+ * 0 for usage_default_limit. flags are ARENA_ flags from arena.h for
+ * the memory holding keys, eg ARENA_LOCK. Key setup runs on ex, NULL
+ * for exec_default(). Returns NULL on bad parameters or if memory
+ * cannot be had.
+ */
+usage *usage_create(int cipher, int w, int r, const void *master,
+                    int mlen, int keylen, uint64_t limit, int flags,
+                    executor *ex);
+
+/* Wait for any setup task, wipe all keys and free. No thread may be
+ * attached.                                                       */
+void usage_destroy(usage *u);
+
+/* Handle for the calling thread, or NULL if USAGE_MAX_THREADS are
+ * attached. A handle is used by one thread at a time.              */
+usage_thread *usage_attach(usage *u);
+void usage_detach(usage_thread *t);
+
+/* Count nblocks blocks against the current epoch and fill bc with its
+ * schedule, and epoch with its number when not NULL. Use bc for at
+ * most nblocks blocks, eg one ctr_crypt or cbc_encrypt of a message,
+ * then call usage_release; the next usage_acquire releases too. A
+ * thread that keeps its hold pins that epoch's schedule in memory.
+ * Returns 0, or -1 if nblocks exceeds the limit or memory for a new
+ * schedule cannot be had.
+ */
+int usage_acquire(usage_thread *t, size_t nblocks, blkcipher *bc,
+                  uint64_t *epoch);
+void usage_release(usage_thread *t);
+
+/* Schedule of any epoch, eg to decrypt what was written under it, to
+ * rkey sized as for rc6_setup/rc5_setup. Returns 0 or -1.          */
+int usage_schedule(usage *u, uint64_t epoch, void *rkey);
+
+/* Blocks counted, the current epoch, and calls that waited for a
+ * schedule, summed over attached and detached threads            */
+void usage_stats(usage *u, uint64_t *blocks, uint64_t *epoch,
+                 uint64_t *stalls);
+
+#endif
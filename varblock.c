@@ -0,0 +1,99 @@
+/*
+// Length-preserving encryption of short messages as one RC6 or RC5
+// block whose word size is chosen from the message length.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rc6_wide.h"
+#include "varblock.h"
+#include "probes.h"
+
+int vb_init(vb_ctx *c, int rc5, int r, int b, const void *key) {
+    if (r<0 || r>255 || b<0 || b>255)
+        return -1;
+    memset(c, 0, sizeof(*c));
+    c->rc5 = rc5; c->r = r; c->b = b;
+    memcpy(c->key, key, b);
+    return 0;
+}
+
+void vb_free(vb_ctx *c) {
+    int i;
+    for (i=0; i<129; i++) {
+        if (c->rkey[i]) {
+            int w = 8*i;
+            memset(c->rkey[i], 0, c->rc5 ? RC5W_RKEY_BYTES(w, c->r)
+                                         : RC6W_RKEY_BYTES(w, c->r));
+            free(c->rkey[i]);
+        }
+    }
+    memset(c, 0, sizeof(*c));
+}
+
+/* Schedule for q-byte blocks, expanded on first use               */
+static void *schedule(vb_ctx *c, size_t q) {
+    int w = (int)(c->rc5 ? 4*q : 2*q);
+    void *rk = c->rkey[w/8];
+    if (rk == NULL) {
+        PROBE1(cache_miss, w);
+        rk = malloc(c->rc5 ? RC5W_RKEY_BYTES(w, c->r)
+                           : RC6W_RKEY_BYTES(w, c->r));
+        if (rk == NULL) return NULL;
+        if (c->rc5) rc5w_setup(rk, w, c->r, c->b, c->key);
+        else        rc6w_setup(rk, w, c->r, c->b, c->key);
+        c->rkey[w/8] = rk;
+    } else
+        PROBE1(cache_hit, w);
+    return rk;
+}
+
+/* Block length q for a len-byte message, or 0 if unsupported      */
+static size_t block_len(const vb_ctx *c, size_t len) {
+    size_t unit = (c->rc5 ? 2 : 4), max = (c->rc5 ? 256 : 512);
+    return (len < unit || len > max ? 0 : len/unit*unit);
+}
+
+int vb_encrypt(vb_ctx *c, const void *in, void *out, size_t len) {
+    unsigned char *o = (unsigned char *)out;
+    size_t q = block_len(c, len);
+    void *rk;
+    int w;
+    if (q == 0 || (rk = schedule(c, q)) == NULL)
+        return -1;
+    w = (int)(c->rc5 ? 4*q : 2*q);
+    memmove(o, in, len);
+    if (c->rc5) rc5w_encrypt(rk, w, c->r, o, o);
+    else        rc6w_encrypt(rk, w, c->r, o, o);
+    if (q < len) {                      /* Steal: encipher the tail */
+        if (c->rc5) rc5w_encrypt(rk, w, c->r, o+len-q, o+len-q);
+        else        rc6w_encrypt(rk, w, c->r, o+len-q, o+len-q);
+        /* Then the head again, so it depends on the tail's input    */
+        if (c->rc5) rc5w_encrypt(rk, w, c->r, o, o);
+        else        rc6w_encrypt(rk, w, c->r, o, o);
+    }
+    return 0;
+}
+
+int vb_decrypt(vb_ctx *c, const void *in, void *out, size_t len) {
+    unsigned char *o = (unsigned char *)out;
+    size_t q = block_len(c, len);
+    void *rk;
+    int w;
+    if (q == 0 || (rk = schedule(c, q)) == NULL)
+        return -1;
+    w = (int)(c->rc5 ? 4*q : 2*q);
+    memmove(o, in, len);
+    if (q < len) {
+        if (c->rc5) rc5w_decrypt(rk, w, c->r, o, o);
+        else        rc6w_decrypt(rk, w, c->r, o, o);
+        if (c->rc5) rc5w_decrypt(rk, w, c->r, o+len-q, o+len-q);
+        else        rc6w_decrypt(rk, w, c->r, o+len-q, o+len-q);
+    }
+    if (c->rc5) rc5w_decrypt(rk, w, c->r, o, o);
+    else        rc6w_decrypt(rk, w, c->r, o, o);
+    return 0;
+}
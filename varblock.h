@@ -0,0 +1,45 @@
+/*
+// Length-preserving encryption of short messages as one RC6 or RC5
+// block whose word size is chosen from the message length.
+//
+// This is free and unencumbered software released into the public
+// domain. For more information, please refer to <http://unlicense.org/>
+*/
+
+/* A message of len bytes is enciphered as a single RC6 block with
+ * w = 2*len bits when len is a multiple of 4 (4..512), or a single
+ * RC5 block with w = 4*len bits when len is even (2..256). Other
+ * lengths up to the maximum are handled by stealing: the first q
+ * bytes are enciphered, then the last q, then the first q again,
+ * where q is len rounded down to the block unit. The blocks overlap,
+ * so after the third call every output byte depends on every input
+ * byte; such lengths cost three block calls instead of one. One key
+ * schedule per w is expanded on first use and kept.
+ *
+ * The cached schedules are filled lazily, so a vb_ctx must not be
+ * used from several threads at once.
+ */
+#ifndef VARBLOCK_H
+#define VARBLOCK_H
+
+#include <stddef.h>
+
+typedef struct {
+    int rc5, r, b;
+    unsigned char key[256];
+    void *rkey[129];            /* Indexed by w/8, NULL until used  */
+} vb_ctx;
+
+/* rc5 selects RC5 (2-byte units, len <= 256) over RC6 (4-byte units,
+ * len <= 512). Returns 0 iff r and b are in 0..255.
+ */
+int vb_init(vb_ctx *c, int rc5, int r, int b, const void *key);
+void vb_free(vb_ctx *c);
+
+/* Both return 0 on success, or -1 if len is below one unit, above the
+ * maximum, or a schedule cannot be allocated. in and out may be equal.
+ */
+int vb_encrypt(vb_ctx *c, const void *in, void *out, size_t len);
+int vb_decrypt(vb_ctx *c, const void *in, void *out, size_t len);
+
+#endif